@@ -12,34 +12,161 @@
 // Contributors: Strizhniou Fiodar - fix build and runtime errors, refactoring.
 //
 // Description:
-//
+//
 
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <memory>
 #include "byte_pair.h"
+#include "cpufeatures.h"
+
+#ifdef CPU_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
-const TInt MaxBlockSize = 0x1000;
+/*
+Pair scan kernels.
 
-TUint16 PairCount[0x10000];
-TUint16 PairBuffer[MaxBlockSize*2];
+Each compares the KScanWindow bytes at data with their successors and with
+the marker. Bit n of equal is set if data[n]==data[n+1], bit n of markers if
+data[n]==marker. They read one byte past the window.
+*/
 
-TUint16 GlobalPairs[0x10000] = {0};
-TUint16 GlobalTokenCounts[0x100] = {0};
+const TInt KScanWindow = 64;
 
-TUint16 ByteCount[0x100+4];
+static void ClassifyPortable(const TUint8* data, TInt marker, TUint64& equal, TUint64& markers)
+	{
+	const TUint64 ones = 0x0101010101010101ull;
+	const TUint64 low7 = ones*0x7f;
+	TUint64 m = ones*(TUint8)marker;
+	equal = 0;
+	markers = 0;
+	for(TInt n=0; n<KScanWindow; n+=8)
+		{
+		TUint64 x = 0;
+		TUint64 y = 0;
+		for(TInt i=7; i>=0; --i)
+			{
+			x = (x<<8)|data[n+i];
+			y = (y<<8)|data[n+i+1];
+			}
+		// top bit of each zero byte, then gathered to the low byte
+		TUint64 v = x^y;
+		v = ~(((v&low7)+low7)|v|low7);
+		equal |= (((v>>7)*0x0102040810204080ull)>>56)<<n;
+		v = x^m;
+		v = ~(((v&low7)+low7)|v|low7);
+		markers |= (((v>>7)*0x0102040810204080ull)>>56)<<n;
+		}
+	}
 
-void CountBytes(TUint8* data, TInt size)
+#ifdef CPU_X86
+static TARGET_SSE2 void ClassifySse2(const TUint8* data, TInt marker, TUint64& equal, TUint64& markers)
 	{
-	memset(ByteCount,0,sizeof(ByteCount));
+	__m128i m = _mm_set1_epi8((char)marker);
+	equal = 0;
+	markers = 0;
+	for(TInt n=0; n<KScanWindow; n+=16)
+		{
+		__m128i a = _mm_loadu_si128((const __m128i*)(data+n));
+		__m128i b = _mm_loadu_si128((const __m128i*)(data+n+1));
+		equal |= (TUint64)(TUint32)_mm_movemask_epi8(_mm_cmpeq_epi8(a,b))<<n;
+		markers |= (TUint64)(TUint32)_mm_movemask_epi8(_mm_cmpeq_epi8(a,m))<<n;
+		}
+	}
+
+static TARGET_AVX2 void ClassifyAvx2(const TUint8* data, TInt marker, TUint64& equal, TUint64& markers)
+	{
+	__m256i m = _mm256_set1_epi8((char)marker);
+	equal = 0;
+	markers = 0;
+	for(TInt n=0; n<KScanWindow; n+=32)
+		{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(data+n));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(data+n+1));
+		equal |= (TUint64)(TUint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a,b))<<n;
+		markers |= (TUint64)(TUint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a,m))<<n;
+		}
+	}
+#endif
+
+// Keeps the bits of every run of set bits that are an even distance
+// from the start of the run.
+static inline TUint64 EvenInRuns(TUint64 runs)
+	{
+	const TUint64 even = 0x5555555555555555ull;
+	TUint64 starts = runs&~(runs<<1);
+	// adding the start bit clears a run, so only runs starting at an even bit vanish
+	TUint64 evenRuns = runs&~(runs+(starts&even));
+	return (evenRuns&even)|(runs&~evenRuns&~even);
+	}
+
+BytePairContext::BytePairContext(TPairSearch aSearch, TScanKernel aKernel):
+	iSearch(aSearch)
+	{
+#ifdef CPU_X86
+	if(aKernel==EScanAuto)
+		aKernel = CpuHasAvx2() ? EScanAvx2 : EScanSse2;
+	if(aKernel==EScanAvx2 && !CpuHasAvx2())
+		aKernel = EScanPortable;
+	if(aKernel==EScanSse2 && !CpuHasSse2())
+		aKernel = EScanPortable;
+#else
+	aKernel = EScanPortable;
+#endif
+	iKernel = aKernel;
+	switch(aKernel)
+		{
+#ifdef CPU_X86
+		case EScanAvx2:
+			iClassifyPairs = ClassifyAvx2;
+			break;
+		case EScanSse2:
+			iClassifyPairs = ClassifySse2;
+			break;
+#endif
+		default:
+			iClassifyPairs = ClassifyPortable;
+			break;
+		}
+	}
+
+BytePairContext::TScanKernel BytePairContext::Kernel() const
+	{
+	return iKernel;
+	}
+
+const TUint16* BytePairContext::CountBytes(TUint8* data, TInt size)
+	{
+	// four histograms, so runs of one value don't wait for the
+	// previous increment of the same counter
+	TUint32 counts[4][0x100];
+	memset(counts,0,sizeof(counts));
+	iCountedData = data;
+	iCountedSize = size;
 	TUint8* dataEnd = data+size;
+	while(dataEnd-data>=4)
+		{
+		++counts[0][data[0]];
+		++counts[1][data[1]];
+		++counts[2][data[2]];
+		++counts[3][data[3]];
+		data += 4;
+		}
 	while(data<dataEnd)
-		++ByteCount[*data++];
+		++counts[0][*data++];
+	memset(iByteCount,0,sizeof(iByteCount));
+	for(TInt b=0; b<0x100; b++)
+		iByteCount[b] = (TUint16)(counts[0][b]+counts[1][b]+counts[2][b]+counts[3][b]);
+	return iByteCount;
 	}
 
 
-inline void ByteUsed(TInt b)
+inline void BytePairContext::ByteUsed(TInt b)
 	{
-	ByteCount[b] = 0xffff;
+	iByteCount[b] = 0xffff;
 	}
 
 
@@ -61,17 +188,56 @@ int TieBreak(int b1,int b2)
 	}
 #endif
 
-int TieBreak(int b1,int b2)
+inline TInt BytePairContext::TieBreak(TInt b1, TInt b2) const
 	{
-	return -ByteCount[b1]-ByteCount[b2];
+	return -iByteCount[b1]-iByteCount[b2];
 	}
 
-TInt MostCommonPair(TInt& pair, TUint8* data, TInt size, TInt minFrequency, TInt marker)
+// Fills iPairCount and puts pairs into iPairBuffer in the order
+// they reach minFrequency, returns the number of such pairs.
+// raw is true if no pairs were replaced in data yet.
+TInt BytePairContext::CountPairs(TUint8* data, TInt size, TInt minFrequency, TInt marker, bool raw)
 	{
-	memset(PairCount,0,sizeof(PairCount));
+	memset(iPairCount,0,sizeof(iPairCount));
 	TUint8* dataEnd = data+size-1;
 	TInt pairsFound = 0;
 	TInt lastPair = -1;
+	// Runs of identical bytes in a raw page make the branches below
+	// unpredictable, so it is counted by whole windows without branching
+	// on the data. Bytes in a run of markers alternate between marker and
+	// escaped byte. In a run of identical bytes only every second pair is
+	// counted, as lastPair prevents double counting. The window starts
+	// after a whole pair or escape sequence, so only lastPair is carried
+	// between them. Once the runs are replaced by tokens the plain loop
+	// is faster.
+	while(raw && dataEnd-data>=KScanWindow)
+		{
+		TUint64 equal;
+		TUint64 markers;
+		iClassifyPairs(data,marker,equal,markers);
+		TUint64 escapes = EvenInRuns(markers);
+		TUint64 special = escapes|(escapes<<1);
+		// the byte after the window is escaped or starts an escape
+		TUint64 specialNext = (escapes>>(KScanWindow-1))|(data[KScanWindow]==marker);
+		TUint64 valid = ~(special|(special>>1)|(specialNext<<(KScanWindow-1)));
+		TUint64 runs = equal&valid;
+		if((runs&1) && lastPair==(data[0]|(data[1]<<8)))
+			runs &= ~(TUint64)1;
+		TUint64 counted = (valid&~equal)|EvenInRuns(runs);
+		lastPair = (counted>>(KScanWindow-1)) ? data[KScanWindow-1]|(data[KScanWindow]<<8) : -1;
+		while(counted)
+			{
+			TInt n = LowestBit(counted);
+			counted &= counted-1;
+			TInt p = data[n]|(data[n+1]<<8);
+			TInt count = iPairCount[p]+1;
+			iPairCount[p] = (TUint16)count;
+			iPairBuffer[pairsFound] = (TUint16)p;
+			pairsFound += (count==minFrequency);
+			}
+		data += KScanWindow+(TInt)(escapes>>(KScanWindow-1));
+		}
+
 	while(data<dataEnd)
 		{
 		TInt b1 = *data++;
@@ -98,19 +264,24 @@ TInt MostCommonPair(TInt& pair, TUint8* data, TInt size, TInt minFrequency, TInt
 			continue;
 			}
 		lastPair = p;
-		++PairCount[p];
-		if(PairCount[p]==minFrequency)
-			PairBuffer[pairsFound++] = (TUint16)p;
+		++iPairCount[p];
+		if(iPairCount[p]==minFrequency)
+			iPairBuffer[pairsFound++] = (TUint16)p;
 		}
+	return pairsFound;
+	}
 
+TInt BytePairContext::MostCommonPair(TInt& pair, TUint8* data, TInt size, TInt minFrequency, TInt marker, bool raw)
+	{
+	TInt pairsFound = CountPairs(data,size,minFrequency,marker,raw);
 	TInt bestCount = -1;
 	TInt bestPair = -1;
 	TInt bestTieBreak = 0;
 	TInt p;
 	while(pairsFound--)
 		{
-		p = PairBuffer[pairsFound];
-		TInt f=PairCount[p];
+		p = iPairBuffer[pairsFound];
+		TInt f=iPairCount[p];
 		if(f>bestCount)
 			{
 			bestCount = f;
@@ -133,13 +304,13 @@ TInt MostCommonPair(TInt& pair, TUint8* data, TInt size, TInt minFrequency, TInt
 	}
 
 
-TInt LeastCommonByte(TInt& byte)
+TInt BytePairContext::LeastCommonByte(TInt& byte) const
 	{
 	TInt bestCount = 0xffff;
 	TInt bestByte = -1;
 	for(TInt b=0; b<0x100; b++)
 		{
-		TInt f = ByteCount[b];
+		TInt f = iByteCount[b];
 		if(f<bestCount)
 			{
 			bestCount = f;
@@ -151,7 +322,391 @@ TInt LeastCommonByte(TInt& byte)
 	}
 
 
-TInt Pak(TUint8* dst, TUint8* src, TInt size)
+/*
+Incremental pair search.
+
+The escaped data is kept as a list of runs of equal bytes. Escaped bytes are
+barriers for pairs and two neighbouring unescaped runs always have different
+values. So pair (v,v) occurs length/2 times in every unescaped run of v and
+pair (x,y) once for every run of x followed by a run of y, exactly as
+MostCommonPair() counts them. Replacing a pair changes only a few runs around
+each occurrence, their pairs are uncounted before the change and counted
+again after it. Pairs are kept in buckets by their count to find the most
+common one quickly.
+*/
+
+inline void BytePairContext::RunPairs(TInt r, TInt sign)
+	{
+	const TRun& run = iRuns[r];
+	if(!run.iEscaped && run.iLength>=2)
+		AdjustPair((run.iValue<<8)|run.iValue, sign*(run.iLength>>1));
+	}
+
+inline void BytePairContext::LinkPair(TInt r1, TInt r2, TInt sign)
+	{
+	if(r1<0 || r2<0)
+		return;
+	const TRun& run1 = iRuns[r1];
+	const TRun& run2 = iRuns[r2];
+	if(!run1.iEscaped && !run2.iEscaped && run1.iValue!=run2.iValue)
+		AdjustPair((run2.iValue<<8)|run1.iValue, sign);
+	}
+
+void BytePairContext::AdjustPair(TInt p, TInt delta)
+	{
+	TInt count = iPairCount[p];
+	if(count)
+		{
+		TInt next = iBucketNext[p];
+		TInt prev = iBucketPrev[p];
+		if(prev>=0)
+			iBucketNext[prev] = next;
+		else
+			iBucket[count] = next;
+		if(next>=0)
+			iBucketPrev[next] = prev;
+		}
+	count += delta;
+	assert(count>=0 && count<=MaxBlockSize);
+	iPairCount[p] = (TUint16)count;
+	if(count)
+		{
+		TInt head = iBucket[count];
+		iBucketNext[p] = head;
+		iBucketPrev[p] = -1;
+		if(head>=0)
+			iBucketPrev[head] = p;
+		iBucket[count] = p;
+		if(count>iMaxCount)
+			iMaxCount = count;
+		}
+	}
+
+// Adds sign times the pairs of the runs between first and last to the
+// counts, including pairs with first and last. Both runs are excluded,
+// -1 stands for the start or the end of the list.
+void BytePairContext::CountBetween(TInt first, TInt last, TInt sign)
+	{
+	TInt prev = first;
+	TInt r = first>=0 ? iRuns[first].iNext : iFirstRun;
+	while(r!=last)
+		{
+		LinkPair(prev,r,sign);
+		RunPairs(r,sign);
+		prev = r;
+		r = iRuns[r].iNext;
+		}
+	LinkPair(prev,last,sign);
+	}
+
+void BytePairContext::AddToValueList(TInt r)
+	{
+	TRun& run = iRuns[r];
+	TInt head = iValueRuns[run.iValue];
+	run.iPrevValue = -1;
+	run.iNextValue = (TInt16)head;
+	if(head>=0)
+		iRuns[head].iPrevValue = (TInt16)r;
+	iValueRuns[run.iValue] = (TInt16)r;
+	}
+
+void BytePairContext::RemoveFromValueList(TInt r)
+	{
+	TRun& run = iRuns[r];
+	if(run.iPrevValue>=0)
+		iRuns[run.iPrevValue].iNextValue = run.iNextValue;
+	else
+		iValueRuns[run.iValue] = run.iNextValue;
+	if(run.iNextValue>=0)
+		iRuns[run.iNextValue].iPrevValue = run.iPrevValue;
+	}
+
+TInt BytePairContext::NewRunAfter(TInt r, TInt value, TInt length)
+	{
+	assert(iRunCount<KMaxRuns);
+	TInt next = iRuns[r].iNext;
+	TUint32 limit = next>=0 ? iRuns[next].iLabel : 0xffffffffu;
+	if(limit-iRuns[r].iLabel<2)
+		{
+		Relabel();
+		limit = next>=0 ? iRuns[next].iLabel : 0xffffffffu;
+		}
+	TInt n = iRunCount++;
+	TRun& run = iRuns[n];
+	run.iLabel = iRuns[r].iLabel+(limit-iRuns[r].iLabel)/2;
+	run.iPrev = (TInt16)r;
+	run.iNext = (TInt16)next;
+	run.iLength = (TUint16)length;
+	run.iValue = (TUint8)value;
+	run.iEscaped = 0;
+	iRuns[r].iNext = (TInt16)n;
+	if(next>=0)
+		iRuns[next].iPrev = (TInt16)n;
+	AddToValueList(n);
+	return n;
+	}
+
+void BytePairContext::RemoveRun(TInt r)
+	{
+	TRun& run = iRuns[r];
+	if(run.iPrev>=0)
+		iRuns[run.iPrev].iNext = run.iNext;
+	else
+		iFirstRun = run.iNext;
+	if(run.iNext>=0)
+		iRuns[run.iNext].iPrev = run.iPrev;
+	if(!run.iEscaped)
+		RemoveFromValueList(r);
+	run.iLength = 0;
+	}
+
+// Joins unescaped run r with its neighbours of the same value.
+void BytePairContext::MergeAround(TInt r)
+	{
+	TInt prev = iRuns[r].iPrev;
+	if(prev>=0 && !iRuns[prev].iEscaped && iRuns[prev].iValue==iRuns[r].iValue)
+		{
+		iRuns[prev].iLength = (TUint16)(iRuns[prev].iLength+iRuns[r].iLength);
+		RemoveRun(r);
+		r = prev;
+		}
+	TInt next = iRuns[r].iNext;
+	if(next>=0 && !iRuns[next].iEscaped && iRuns[next].iValue==iRuns[r].iValue)
+		{
+		iRuns[r].iLength = (TUint16)(iRuns[r].iLength+iRuns[next].iLength);
+		RemoveRun(next);
+		}
+	}
+
+void BytePairContext::Relabel()
+	{
+	TUint32 label = 0;
+	for(TInt r=iFirstRun; r>=0; r=iRuns[r].iNext)
+		{
+		label += 1<<18;
+		iRuns[r].iLabel = label;
+		}
+	}
+
+void BytePairContext::BuildRuns(TUint8* data, TInt size, TInt marker)
+	{
+	memset(iValueRuns,0xff,sizeof(iValueRuns));
+	iRunCount = 0;
+	iFirstRun = -1;
+	iDataSize = size;
+	TInt last = -1;
+	TUint8* p = data;
+	TUint8* dataEnd = data+size;
+	while(p<dataEnd)
+		{
+		TInt escaped = 0;
+		TInt b = *p++;
+		if(b==marker)
+			{
+			escaped = 1;
+			b = *p++;
+			}
+		if(last>=0 && !escaped && !iRuns[last].iEscaped && iRuns[last].iValue==b)
+			{
+			++iRuns[last].iLength;
+			continue;
+			}
+		TInt r = iRunCount++;
+		TRun& run = iRuns[r];
+		run.iLabel = (TUint32)(r+1)<<18;
+		run.iPrev = (TInt16)last;
+		run.iNext = -1;
+		run.iLength = 1;
+		run.iValue = (TUint8)b;
+		run.iEscaped = (TUint8)escaped;
+		if(last>=0)
+			iRuns[last].iNext = (TInt16)r;
+		else
+			iFirstRun = r;
+		if(!escaped)
+			AddToValueList(r);
+		last = r;
+		}
+
+	for(TInt i=0; i<=MaxBlockSize; i++)
+		iBucket[i] = -1;
+	iMaxCount = 0;
+	TInt pairsFound = CountPairs(data,size,1,marker,true);
+	while(pairsFound--)
+		{
+		TInt pair = iPairBuffer[pairsFound];
+		TInt count = iPairCount[pair];
+		iPairCount[pair] = 0;
+		AdjustPair(pair,count);
+		}
+	}
+
+// Returns the position of the occurrence at which MostCommonPair() would
+// count the pair for the minFrequency-th time.
+TUint64 BytePairContext::MinFrequencyPosition(TInt pair, TInt minFrequency)
+	{
+	TInt b1 = pair&0xff;
+	TInt b2 = pair>>8;
+	TInt n = 0;
+	for(TInt r=iValueRuns[b1]; r>=0; r=iRuns[r].iNextValue)
+		{
+		const TRun& run = iRuns[r];
+		TUint64 label = (TUint64)run.iLabel<<32;
+		if(b1!=b2)
+			{
+			TInt next = run.iNext;
+			if(next>=0 && !iRuns[next].iEscaped && iRuns[next].iValue==b2)
+				iPositions[n++] = label|(run.iLength-1);
+			}
+		else if(run.iLength>=2)
+			iPositions[n++] = label|(run.iLength>>1);
+		}
+	if(b1!=b2)
+		{
+		std::nth_element(iPositions,iPositions+minFrequency-1,iPositions+n);
+		return iPositions[minFrequency-1];
+		}
+	// pairs of identical bytes are counted at every second byte of a run
+	std::sort(iPositions,iPositions+n);
+	TInt left = minFrequency;
+	for(TInt i=0; ; i++)
+		{
+		TInt count = (TInt)(iPositions[i]&0xffffffffu);
+		if(left<=count)
+			return (iPositions[i]&~(TUint64)0xffffffffu)|(2*(left-1));
+		left -= count;
+		}
+	}
+
+TInt BytePairContext::BestPair(TInt& pair, TInt minFrequency)
+	{
+	while(iMaxCount>0 && iBucket[iMaxCount]<0)
+		--iMaxCount;
+	pair = -1;
+	if(iMaxCount<minFrequency)
+		return -1;
+
+	TInt bestTieBreak = 0;
+	TInt ties = 0;
+	TInt p;
+	for(p=iBucket[iMaxCount]; p>=0; p=iBucketNext[p])
+		{
+		TInt tieBreak = TieBreak(p&0xff,p>>8);
+		if(pair<0 || tieBreak>bestTieBreak)
+			{
+			pair = p;
+			bestTieBreak = tieBreak;
+			ties = 0;
+			}
+		else if(tieBreak==bestTieBreak)
+			++ties;
+		}
+	if(ties)
+		{
+		// MostCommonPair() takes the pair which reached minFrequency last
+		TUint64 bestPosition = 0;
+		for(p=iBucket[iMaxCount]; p>=0; p=iBucketNext[p])
+			{
+			if(TieBreak(p&0xff,p>>8)!=bestTieBreak)
+				continue;
+			TUint64 position = MinFrequencyPosition(p,minFrequency);
+			if(position>=bestPosition)
+				{
+				bestPosition = position;
+				pair = p;
+				}
+			}
+		}
+	return iMaxCount;
+	}
+
+// Escapes byte and replaces pair by it, returns the new data size.
+TInt BytePairContext::ReplacePair(TInt byte, TInt byteCount, TInt pair, TInt pairCount)
+	{
+	TInt r = iValueRuns[byte];
+	while(r>=0)
+		{
+		// escaped runs have no pairs, only uncount the old ones
+		TInt nextValue = iRuns[r].iNextValue;
+		CountBetween(iRuns[r].iPrev,iRuns[r].iNext,-1);
+		RemoveFromValueList(r);
+		iRuns[r].iEscaped = 1;
+		byteCount -= iRuns[r].iLength;
+		iDataSize += iRuns[r].iLength;
+		r = nextValue;
+		}
+	assert(!byteCount);
+
+	TInt b1 = pair&0xff;
+	TInt b2 = pair>>8;
+	TInt found = 0;
+	for(r=iValueRuns[b1]; r>=0; r=iRuns[r].iNextValue)
+		{
+		TInt next = iRuns[r].iNext;
+		if(b1==b2 ? iRuns[r].iLength>=2 : next>=0 && !iRuns[next].iEscaped && iRuns[next].iValue==b2)
+			iRunBuffer[found++] = (TInt16)r;
+		}
+
+	for(TInt i=0; i<found; i++)
+		{
+		r = iRunBuffer[i];
+		TInt prev = iRuns[r].iPrev;
+		TInt next = iRuns[r].iNext;
+		if(b1!=b2)
+			next = iRuns[next].iNext;
+		TInt first = prev>=0 ? iRuns[prev].iPrev : -1;
+		TInt last = next>=0 ? iRuns[next].iNext : -1;
+		CountBetween(first,last,-1);
+		if(b1==b2)
+			{
+			TInt length = iRuns[r].iLength;
+			RemoveFromValueList(r);
+			iRuns[r].iValue = (TUint8)byte;
+			iRuns[r].iLength = (TUint16)(length>>1);
+			AddToValueList(r);
+			if(length&1)
+				NewRunAfter(r,b1,1);
+			MergeAround(r);
+			pairCount -= length>>1;
+			iDataSize -= length>>1;
+			}
+		else
+			{
+			TInt r2 = iRuns[r].iNext;
+			TInt token = NewRunAfter(r,byte,1);
+			if(!--iRuns[r].iLength)
+				RemoveRun(r);
+			if(!--iRuns[r2].iLength)
+				RemoveRun(r2);
+			MergeAround(token);
+			--pairCount;
+			--iDataSize;
+			}
+		CountBetween(first,last,1);
+		}
+	assert(!pairCount);
+	return iDataSize;
+	}
+
+TInt BytePairContext::WriteRuns(TUint8* dst, TInt marker) const
+	{
+	TUint8* dstStart = dst;
+	for(TInt r=iFirstRun; r>=0; r=iRuns[r].iNext)
+		{
+		const TRun& run = iRuns[r];
+		for(TInt n=run.iLength; n>0; --n)
+			{
+			if(run.iEscaped)
+				*dst++ = (TUint8)marker;
+			*dst++ = run.iValue;
+			}
+		}
+	assert(dst-dstStart==iDataSize);
+	return iDataSize;
+	}
+
+
+TInt BytePairContext::Pak(TUint8* dst, TUint8* src, TInt size)
 	{
 	TInt originalSize = size;
 	TUint8* dst2 = dst+size*2;
@@ -162,6 +717,7 @@ TInt Pak(TUint8* dst, TUint8* src, TInt size)
 	TInt tokenCount = 0;
 
 	CountBytes(in,size);
+	iCountedData = nullptr; // the counts change below
 
 	TInt marker = -1;
 	TInt overhead = 1+3+LeastCommonByte(marker);
@@ -182,12 +738,19 @@ TInt Pak(TUint8* dst, TUint8* src, TInt size)
 	in = dst;
 	out = dst2;
 
+	if(iSearch==EPairIncremental)
+		BuildRuns(in,size,marker);
+
 	for(TInt r=256; r>0; --r)
 		{
 		TInt byte;
 		TInt byteCount = LeastCommonByte(byte);
 		TInt pair;
-		TInt pairCount = MostCommonPair(pair,in,size,overhead+1,marker);
+		TInt pairCount;
+		if(iSearch==EPairIncremental)
+			pairCount = BestPair(pair,overhead+1);
+		else
+			pairCount = MostCommonPair(pair,in,size,overhead+1,marker,tokenCount==0);
 		TInt saving = pairCount-byteCount;
 		if(saving<=overhead)
 			break;
@@ -204,7 +767,13 @@ TInt Pak(TUint8* dst, TUint8* src, TInt size)
 		ByteUsed(pair&0xff);
 		*d++ = (TUint8)(pair>>8);
 		ByteUsed(pair>>8);
-		++GlobalPairs[pair];
+		++iGlobalPairs[pair];
+
+		if(iSearch==EPairIncremental)
+			{
+			size = ReplacePair(byte,byteCount,pair,pairCount);
+			continue;
+			}
 
 		inEnd = in+size;
 		outStart = out;
@@ -246,6 +815,12 @@ TInt Pak(TUint8* dst, TUint8* src, TInt size)
 			}
 		}
 
+	if(iSearch==EPairIncremental)
+		{
+		size = WriteRuns(dst2,marker);
+		in = dst2;
+		}
+
 	// sort tokens with a bubble sort...
 	for(TInt x=0; x<tokenCount-1; x++)
 		for(TInt y=x+1; y<tokenCount; y++)
@@ -306,45 +881,209 @@ TInt Pak(TUint8* dst, TUint8* src, TInt size)
 	dst += size;
 
 	// get stats...
-	++GlobalTokenCounts[tokenCount];
+	++iGlobalTokenCounts[tokenCount];
 
 	// return total size of compressed data...
 	return dst-originalDst;
 	}
 
 
-TInt Unpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNext)
+/**
+Check whether Pak() would store data uncompressed, without searching for
+tokens. Must follow CountBytes(src,size), which is asserted.
+
+The first round of Pak() only creates a token if some pair of the escaped
+data occurs more than overhead+byteCount times, and no later round can start
+without a first token. So a single count of the escaped pairs against that
+threshold decides it.
+
+@internalComponent
+@released
+*/
+bool BytePairContext::StoresRaw(TUint8* src, TInt size)
 	{
-	TUint8* dstStart = dst;
-	TUint8* dstEnd = dst+dstSize;
-	TUint8* srcEnd = src+srcSize;
+	assert(src==iCountedData && size==iCountedSize);
+	TInt marker = -1;
+	TInt markerCount = LeastCommonByte(marker);
+	TUint16 saved = iByteCount[marker];
+	ByteUsed(marker);
+	TInt byte;
+	TInt byteCount = LeastCommonByte(byte);
+	iByteCount[marker] = saved;
 
-	TUint32 LUT[0x100/2];
-	TUint8* LUT0 = (TUint8*)LUT;
-	TUint8* LUT1 = LUT0+0x100;
+	TUint8* data = src;
+	if(markerCount)
+		{
+		TUint8* out = iPakBuffer;
+		TUint8* srcEnd = src+size;
+		while(src<srcEnd)
+			{
+			TInt b=*src++;
+			if(b==marker)
+				*out++ = (TUint8)b;
+			*out++ = (TUint8)b;
+			}
+		data = iPakBuffer;
+		size = out-iPakBuffer;
+		}
+	return CountPairs(data,size,1+3+markerCount+byteCount+1,marker,true)==0;
+	}
 
-	TUint8 stack[0x100];
-	TUint8* stackStart = stack+sizeof(stack);
-	TUint8* sp = stackStart;
 
-	TUint32 marker = ~0u;
-	TInt numTokens;
-	TUint32 p1;
-	TUint32 p2;
+/**
+Pak() size bytes of value.
 
-	TUint32* lut = (TUint32*)LUT;
-	TUint32 b = 0x03020100;
-	TUint32 step = 0x04040404;
-	do
+Pak() replaces the most common pair of a constant page with a token, then
+the pair of two such tokens with the next token and so on, taking unused
+bytes in ascending order for the marker and the tokens. The result is built
+here directly and is identical to the one of Pak().
+
+@internalComponent
+@released
+*/
+TInt BytePairContext::PakRun(TUint8* dst, TInt value, TInt size)
+	{
+	TUint8 unused[0x100];
+	TInt unusedCount = 0;
+	for(TInt b=0; b<0x100; b++)
+		if(b!=value)
+			unused[unusedCount++] = (TUint8)b;
+	TInt marker = unused[0];
+
+	// every round halves the run, leaving an odd byte behind it
+	TInt lengths[0x20];
+	TInt tokenCount = 0;
+	TInt length = size;
+	TInt overhead = 1+3;
+	while(length/2>overhead)
+		{
+		lengths[tokenCount++] = length;
+		length /= 2;
+		overhead = 3;
+		}
+
+	TUint8* originalDst = dst;
+	*dst++ = (TUint8)tokenCount;
+	if(tokenCount)
+		*dst++ = (TUint8)marker;
+	TInt token = value;
+	for(TInt t=0; t<tokenCount; t++)
 		{
-		*lut++ = b;
-		b += step;
+		*dst++ = unused[t+1];
+		*dst++ = (TUint8)token;
+		*dst++ = (TUint8)token;
+		++iGlobalPairs[token|(token<<8)];
+		token = unused[t+1];
 		}
-	while(b>step);
+	memset(dst,token,length);
+	dst += length;
+	while(tokenCount--)
+		if(lengths[tokenCount]&1)
+			*dst++ = tokenCount ? unused[tokenCount] : (TUint8)value;
+
+	// get stats...
+	++iGlobalTokenCounts[originalDst[0]];
+
+	return dst-originalDst;
+	}
+
+
+/*
+Table-driven page decoder.
+
+Every byte value stands either for itself or, as a token, for the expansions
+of its pair. Before decoding, the length of every token is computed and the
+expansions of up to KUnpakShort bytes are written to a table, so most input
+bytes are decoded by a single copy of KUnpakShort bytes with a length known
+in advance. Longer tokens are expanded pair by pair at their first occurrence
+and later copied from there in the output.
 
+Input is accepted or refused as by the original recursive decoder. Cyclic
+tokens are corrupt, the original ran out of its stack or output on them.
+Tokens without cycles never nest deeper than its stack of 256 entries. The
+original wrote one byte past dstEnd when the last token didn't fit, here that
+is corrupt too.
+*/
+
+namespace
+{
+const TInt KUnpakShort = 16;
+const TUint32 KUnpakEndless = 0x7fffffff;
+
+enum TUnpakState {EUnpakNew, EUnpakActive, EUnpakDone};
+
+struct TUnpakTable
+	{
+	TUint8 iPair[2][0x100];
+	TUint8 iShort[0x100][KUnpakShort];	// expansions of up to KUnpakShort bytes
+	TUint8 iFast[0x100];				// length of the expansion in iShort, or 0
+	TUint32 iLength[0x100];
+	TInt32 iCopy[0x100];				// output offset of the first expansion, or -1
+	TUint8 iState[0x100];
+	};
+}
+
+static void UnpakMeasure(TUnpakTable& aTable, TInt aByte)
+	{
+	aTable.iState[aByte] = EUnpakActive;
+	TUint32 length = 0;
+	for(TInt half=0; half<2; half++)
+		{
+		TInt b = aTable.iPair[half][aByte];
+		if(aTable.iState[b]==EUnpakNew)
+			UnpakMeasure(aTable,b);
+		TUint32 l = aTable.iState[b]==EUnpakDone ? aTable.iLength[b] : KUnpakEndless;
+		length = std::min(length+l,KUnpakEndless);
+		}
+	aTable.iLength[aByte] = length;
+	aTable.iState[aByte] = EUnpakDone;
+	if(length<=KUnpakShort)
+		{
+		TInt left = aTable.iPair[0][aByte];
+		TInt right = aTable.iPair[1][aByte];
+		TUint32 leftLength = aTable.iLength[left];
+		memcpy(aTable.iShort[aByte],aTable.iShort[left],leftLength);
+		memcpy(aTable.iShort[aByte]+leftLength,aTable.iShort[right],length-leftLength);
+		aTable.iFast[aByte] = (TUint8)length;
+		}
+	}
+
+static TUint8* UnpakExpand(TUnpakTable& aTable, TUint8* aDstStart, TUint8* aDst, TInt aByte)
+	{
+	TInt32 offset = aDst-aDstStart;
+	for(TInt half=0; half<2; half++)
+		{
+		TInt b = aTable.iPair[half][aByte];
+		TUint32 length = aTable.iLength[b];
+		if(length<=KUnpakShort)
+			memcpy(aDst,aTable.iShort[b],length);
+		else if(aTable.iCopy[b]>=0)
+			memcpy(aDst,aDstStart+aTable.iCopy[b],length);
+		else
+			UnpakExpand(aTable,aDstStart,aDst,b);
+		aDst += length;
+		}
+	aTable.iCopy[aByte] = offset;
+	return aDst;
+	}
+
+TInt Unpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNext)
+	{
+	TUint8* dstStart = dst;
+	TUint8* dstEnd = dst+dstSize;
+	TUint8* srcEnd = src+srcSize;
+
+	TUnpakTable table;
+	TUint8* LUT0 = table.iPair[0];
+	TUint8* LUT1 = table.iPair[1];
+	for(TInt b=0; b<0x100; b++)
+		LUT0[b] = LUT1[b] = (TUint8)b;
+
+	TInt marker = -1;
 	if(src>=srcEnd)
 		goto error;
-	numTokens = *src++;
+	{
+	TInt numTokens = *src++;
 	if(numTokens)
 		{
 		if(src>=srcEnd)
@@ -360,10 +1099,9 @@ TInt Unpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNex
 			do
 				{
 				TInt b = *src++;
-				TInt p1 = *src++;
-				TInt p2 = *src++;
-				LUT0[b] = (TUint8)p1;
-				LUT1[b] = (TUint8)p2;
+				LUT0[b] = src[0];
+				LUT1[b] = src[1];
+				src += 2;
 				}
 			while(src<tokenEnd);
 			}
@@ -373,112 +1111,112 @@ TInt Unpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNex
 			src += 32;
 			if(src>srcEnd)
 				goto error;
-			TInt b=0;
-			do
-				{
-				TUint8 mask = bitMask[b>>3];
-				if(mask&(1<<(b&7)))
+			for(TInt b=0; b<0x100; b++)
+				if(bitMask[b>>3]&(1<<(b&7)))
 					{
-					if(src>srcEnd)
+					if(srcEnd-src<2)
 						goto error;
-					TInt p1 = *src++;
-					if(src>srcEnd)
-						goto error;
-					TInt p2 = *src++;
-					LUT0[b] = (TUint8)p1;
-					LUT1[b] = (TUint8)p2;
+					LUT0[b] = src[0];
+					LUT1[b] = src[1];
+					src += 2;
 					--numTokens;
 					}
-				++b;
-				}
-			while(b<0x100);
 			if(numTokens)
 				goto error;
 			}
 		}
+	}
 
-	if(src>=srcEnd)
-		goto error;
-	b = *src++;
-	if(dst>=dstEnd)
-		goto error;
-	p1 = LUT0[b];
-	if(p1!=b)
-		goto not_single;
-next:
-	if(src>=srcEnd)
-		goto done_s;
-	b = *src++;
-	*dst++ = (TUint8)p1;
-	if(dst>=dstEnd)
-		goto done_d;
-	p1 = LUT0[b];
-	if(p1==b)
-		goto next;
-
-not_single:
-	if(b==marker)
-		goto do_marker;
-
-do_pair:
-	p2 = LUT1[b];
-	b = p1;
-	p1 = LUT0[b];
-	if(sp<=stack)
-		goto error;
-	*--sp = (TUint8)p2;
-
-recurse:
-	if(b!=p1)
-		goto do_pair;
+	for(TInt b=0; b<0x100; b++)
+		{
+		bool literal = LUT0[b]==b;
+		table.iShort[b][0] = (TUint8)b;
+		table.iFast[b] = literal;
+		table.iLength[b] = 1;
+		table.iCopy[b] = -1;
+		table.iState[b] = (TUint8)(literal ? EUnpakDone : EUnpakNew);
+		}
+	for(TInt b=0; b<0x100; b++)
+		if(table.iState[b]==EUnpakNew)
+			UnpakMeasure(table,b);
+	// the marker is a token only inside other tokens
+	if(marker>=0 && LUT0[marker]!=marker)
+		table.iFast[marker] = 0;
 
-	if(sp==stackStart)
-		goto next;
-	b = *sp++;
-	if(dst>=dstEnd)
+	if(src>=srcEnd || dst>=dstEnd)
 		goto error;
-	*dst++ = (TUint8)p1;
-	p1 = LUT0[b];
-	goto recurse;
+	do
+		{
+		TInt b = *src++;
+		TUint32 length = table.iFast[b];
+		if(length && dstEnd-dst>=KUnpakShort)
+			{
+			memcpy(dst,table.iShort[b],KUnpakShort);
+			dst += length;
+			continue;
+			}
+		if(b==marker && LUT0[b]!=b)
+			{
+			if(src>=srcEnd)
+				goto error;
+			*dst++ = *src++;
+			continue;
+			}
+		length = table.iLength[b];
+		if(length>(TUint32)(dstEnd-dst))
+			goto error;
+		if(length<=KUnpakShort)
+			memcpy(dst,table.iShort[b],length);
+		else if(table.iCopy[b]>=0)
+			memcpy(dst,dstStart+table.iCopy[b],length);
+		else
+			UnpakExpand(table,dstStart,dst,b);
+		dst += length;
+		}
+	while(src<srcEnd && dst<dstEnd);
 
-do_marker:
-	if(src>=srcEnd)
-		goto error;
-	p1 = *src++;
-	goto next;
+	srcNext = src;
+	return dst-dstStart;
 
 error:
 	srcNext = nullptr;
 	return KErrCorrupt;
-
-done_s:
-	*dst++ = (TUint8)p1;
-	srcNext = src;
-	return dst-dstStart;
-
-done_d:
-	if(dst>=dstEnd)
-		--src;
-	srcNext = src;
-	return dst-dstStart;
 	}
 
 
-TUint8 PakBuffer[MaxBlockSize*4];
-TUint8 UnpakBuffer[MaxBlockSize];
-
-
-TInt BytePairCompress(TUint8* dst, TUint8* src, TInt size)
+TInt BytePairContext::BytePairCompress(TUint8* dst, TUint8* src, TInt size)
 	{
 	assert(size<=MaxBlockSize);
-	TInt compressedSize = Pak(PakBuffer,src,size);
+	CountBytes(src,size);
+	if(StoresRaw(src,size))
+		return KErrTooBig;
+	TInt compressedSize = Pak(iPakBuffer,src,size);
 	TUint8* pakEnd;
-	TInt us = Unpak(UnpakBuffer,MaxBlockSize,PakBuffer,compressedSize,pakEnd);
+	TInt us = Unpak(iUnpakBuffer,MaxBlockSize,iPakBuffer,compressedSize,pakEnd);
 	assert(us==size);
-	assert(pakEnd==PakBuffer+compressedSize);
-	assert(!memcmp(src,UnpakBuffer,size));
+	assert(pakEnd==iPakBuffer+compressedSize);
+	assert(!memcmp(src,iUnpakBuffer,size));
 	if(compressedSize>=size)
 		return KErrTooBig;
-	memcpy(dst,PakBuffer,compressedSize);
+	memcpy(dst,iPakBuffer,compressedSize);
 	return compressedSize;
 	}
+
+
+static BytePairContext& ThreadContext()
+	{
+	static thread_local std::unique_ptr<BytePairContext> context;
+	if(!context)
+		context.reset(new BytePairContext);
+	return *context;
+	}
+
+TInt Pak(TUint8* dst, TUint8* src, TInt size)
+	{
+	return ThreadContext().Pak(dst,src,size);
+	}
+
+TInt BytePairCompress(TUint8* dst, TUint8* src, TInt size)
+	{
+	return ThreadContext().BytePairCompress(dst,src,size);
+	}
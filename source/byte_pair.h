@@ -19,6 +19,109 @@
 
 #include <portable.h>
 
+const TInt MaxBlockSize = 0x1000;
+
+// Version of the output of Pak(), change it with any change of the output,
+// so cached pages of an older version are not used
+const TUint32 KBytePairVersion = 1;
+
+/**
+Working state of the byte-pair compressor.
+
+Every compression call only touches the tables of its own context, so pages
+may be compressed concurrently as long as each thread uses its own instance.
+The object is large (about a megabyte), allocate it on the heap.
+
+Both pair search methods produce identical output. EPairRescan recounts all
+pairs of the page for every token, EPairIncremental counts them once and then
+updates the counts around each replaced pair.
+
+The first pair scan of a page classifies its bytes with SSE2 or AVX2 when
+the CPU has them. EScanAuto selects the widest available kernel, an
+unsupported one falls back to EScanPortable.
+@internalComponent
+@released
+*/
+class BytePairContext
+{
+	public:
+		enum TPairSearch {EPairRescan, EPairIncremental};
+		enum TScanKernel {EScanAuto, EScanPortable, EScanSse2, EScanAvx2};
+		explicit BytePairContext(TPairSearch aSearch = EPairIncremental, TScanKernel aKernel = EScanAuto);
+		TScanKernel Kernel() const;
+		TInt Pak(TUint8* dst, TUint8* src, TInt size);
+		TInt BytePairCompress(TUint8* dst, TUint8* src, TInt size);
+		// shortcuts for pages which need no pair search
+		const TUint16* CountBytes(TUint8* data, TInt size);
+		bool StoresRaw(TUint8* src, TInt size);
+		TInt PakRun(TUint8* dst, TInt value, TInt size);
+	private:
+		inline void ByteUsed(TInt b);
+		inline TInt TieBreak(TInt b1, TInt b2) const;
+		TInt CountPairs(TUint8* data, TInt size, TInt minFrequency, TInt marker, bool raw);
+		TInt MostCommonPair(TInt& pair, TUint8* data, TInt size, TInt minFrequency, TInt marker, bool raw);
+		TInt LeastCommonByte(TInt& byte) const;
+	private:
+		// incremental pair search
+		void BuildRuns(TUint8* data, TInt size, TInt marker);
+		TInt BestPair(TInt& pair, TInt minFrequency);
+		TInt ReplacePair(TInt byte, TInt byteCount, TInt pair, TInt pairCount);
+		TInt WriteRuns(TUint8* dst, TInt marker) const;
+		void AdjustPair(TInt p, TInt delta);
+		inline void RunPairs(TInt r, TInt sign);
+		inline void LinkPair(TInt r1, TInt r2, TInt sign);
+		void CountBetween(TInt first, TInt last, TInt sign);
+		TInt NewRunAfter(TInt r, TInt value, TInt length);
+		void AddToValueList(TInt r);
+		void RemoveFromValueList(TInt r);
+		void RemoveRun(TInt r);
+		void MergeAround(TInt r);
+		void Relabel();
+		TUint64 MinFrequencyPosition(TInt pair, TInt minFrequency);
+	private:
+		struct TRun
+			{
+			TUint32 iLabel;		// increases along the list
+			TInt16 iPrev;
+			TInt16 iNext;
+			TInt16 iPrevValue;	// list of unescaped runs with the same value
+			TInt16 iNextValue;
+			TUint16 iLength;	// zero once removed
+			TUint8 iValue;
+			TUint8 iEscaped;
+			};
+		enum {KMaxRuns = MaxBlockSize*2};
+	private:
+		TPairSearch iSearch;
+		TScanKernel iKernel;
+		void (*iClassifyPairs)(const TUint8* data, TInt marker, TUint64& equal, TUint64& markers);
+		TUint16 iPairCount[0x10000];
+		TUint16 iPairBuffer[MaxBlockSize*2];
+		TUint16 iByteCount[0x100+4];
+		// incremental pair search: data as a list of runs of equal bytes
+		// and pairs in buckets by their count
+		TRun iRuns[KMaxRuns];
+		TInt iRunCount;
+		TInt iFirstRun;
+		TInt iDataSize;
+		TInt16 iValueRuns[0x100];
+		TInt16 iRunBuffer[MaxBlockSize];
+		TUint64 iPositions[MaxBlockSize];
+		TInt32 iBucketNext[0x10000];
+		TInt32 iBucketPrev[0x10000];
+		TInt32 iBucket[MaxBlockSize+1];
+		TInt iMaxCount;
+		// statistics only
+		TUint16 iGlobalPairs[0x10000] = {0};
+		TUint16 iGlobalTokenCounts[0x100] = {0};
+		TUint8 iPakBuffer[MaxBlockSize*4];
+		TUint8 iUnpakBuffer[MaxBlockSize];
+		// data of the byte counts, for StoresRaw()
+		const TUint8* iCountedData = nullptr;
+		TInt iCountedSize = 0;
+};
+
+// These use a context private to the calling thread
 TInt BytePairCompress(TUint8* dst, TUint8* src, TInt size);
 TInt Pak(TUint8* dst, TUint8* src, TInt size);
 TInt Unpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNext);
@@ -21,6 +21,11 @@
 #include <portable.h>
 #include "checksum.h"
 
+#ifdef CPU_X86
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
 typedef unsigned char uint8;
 
 /**
@@ -76,10 +81,9 @@ static const uint32_t crcTab[256] =
 };
 
 /**
-Performs a CCITT CRC checksum on the specified data.
+Performs a CCITT CRC checksum on the specified data, one byte at a time.
 
-On return from this function, the referenced 16 bit integer contains the checksummed
-value.
+This is the reference for the other implementations.
 
 @param aPtr    A pointer to the start of the data to be checksummed.
 @param aLength The length of the data to be checksummed.
@@ -87,7 +91,7 @@ value.
 @internalComponent
 @released
 */
-unsigned short Crc(const void * aPtr, uint32_t aLength)
+uint16_t CrcBytes(const void * aPtr, uint32_t aLength)
 {
 
 	const uint8 * pB=(const uint8 *)aPtr;
@@ -168,10 +172,9 @@ static const uint32_t CrcTab32[256] =
 	};
 
 /**
-Performs a CCITT CRC-32 checksum on the specified data.
+Performs a CCITT CRC-32 checksum on the specified data, one byte at a time.
 
-On return from this function, the referenced 32 bit integer contains the CRC
-value.
+This is the reference for the other implementations.
 
 @param aPtr		A pointer to the start of the data to be checksummed.
 @param aLength	The length of the data to be checksummed.
@@ -179,7 +182,7 @@ value.
 @internalComponent
 @released
 */
-uint32_t Crc32(const void * aPtr, uint32_t aLength)
+uint32_t Crc32Bytes(const void * aPtr, uint32_t aLength)
 {
 	const uint8 * p = (const uint8 *)aPtr;
 	const uint8 * q = p + aLength;
@@ -189,3 +192,243 @@ uint32_t Crc32(const void * aPtr, uint32_t aLength)
 	return crc;
 }
 
+/**
+Tables for slicing-by-8, entry k of a byte is its CRC followed by k zero bytes.
+Entry 0 is the byte-at-a-time table.
+@internalComponent
+@released
+*/
+class TCrcSlices
+{
+public:
+	TCrcSlices();
+public:
+	uint16_t iCrc[8][256];
+	uint32_t iCrc32[8][256];
+};
+
+TCrcSlices::TCrcSlices()
+{
+	for (int i = 0; i < 256; i++)
+	{
+		iCrc[0][i] = (uint16_t)crcTab[i];
+		iCrc32[0][i] = CrcTab32[i];
+	}
+	for (int k = 1; k < 8; k++)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			uint32_t crc = iCrc[k-1][i];
+			iCrc[k][i] = (uint16_t)((crc << 8) ^ crcTab[crc >> 8]);
+			uint32_t crc32 = iCrc32[k-1][i];
+			iCrc32[k][i] = (crc32 >> 8) ^ CrcTab32[crc32 & 0xff];
+		}
+	}
+}
+
+static const TCrcSlices& CrcSlices()
+{
+	static const TCrcSlices slices;
+	return slices;
+}
+
+static inline uint32_t Load32(const uint8 * p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+Performs a CCITT CRC checksum on the specified data, eight bytes at a time.
+
+The CRC only affects the first two bytes of every eight, so their lookups are
+combined with it and the lookups of all eight bytes are independent.
+
+@param aPtr    A pointer to the start of the data to be checksummed.
+@param aLength The length of the data to be checksummed.
+@return        A 16 bit integer contain the checksummed value.
+@internalComponent
+@released
+*/
+uint16_t CrcSlicing8(const void * aPtr, uint32_t aLength)
+{
+	const TCrcSlices& s = CrcSlices();
+	const uint8 * p = (const uint8 *)aPtr;
+	const uint8 * q = p + aLength;
+	uint32_t crc = 0;
+	while (q - p >= 8)
+	{
+		crc = s.iCrc[7][(crc >> 8) ^ p[0]] ^ s.iCrc[6][(crc & 0xff) ^ p[1]] ^
+			s.iCrc[5][p[2]] ^ s.iCrc[4][p[3]] ^ s.iCrc[3][p[4]] ^ s.iCrc[2][p[5]] ^
+			s.iCrc[1][p[6]] ^ s.iCrc[0][p[7]];
+		p += 8;
+	}
+	while (p < q)
+		crc = (crc << 8) ^ crcTab[((crc >> 8) ^ *p++) & 0xff];
+	return crc;
+}
+
+/**
+Continue a CRC-32 eight bytes at a time.
+
+@param aCrc		The CRC of the data before aPtr.
+@param aPtr		A pointer to the start of the data to be checksummed.
+@param aEnd		The end of the data.
+@return         The CRC of the data up to aEnd.
+@internalComponent
+@released
+*/
+static uint32_t Crc32Slicing8(uint32_t aCrc, const uint8 * aPtr, const uint8 * aEnd)
+{
+	const TCrcSlices& s = CrcSlices();
+	while (aEnd - aPtr >= 8)
+	{
+		uint32_t one = aCrc ^ Load32(aPtr);
+		uint32_t two = Load32(aPtr + 4);
+		aCrc = s.iCrc32[7][one & 0xff] ^ s.iCrc32[6][(one >> 8) & 0xff] ^
+			s.iCrc32[5][(one >> 16) & 0xff] ^ s.iCrc32[4][one >> 24] ^
+			s.iCrc32[3][two & 0xff] ^ s.iCrc32[2][(two >> 8) & 0xff] ^
+			s.iCrc32[1][(two >> 16) & 0xff] ^ s.iCrc32[0][two >> 24];
+		aPtr += 8;
+	}
+	while (aPtr < aEnd)
+		aCrc = (aCrc >> 8) ^ CrcTab32[(aCrc ^ *aPtr++) & 0xff];
+	return aCrc;
+}
+
+/**
+Performs a CCITT CRC-32 checksum on the specified data, eight bytes at a time.
+
+@param aPtr		A pointer to the start of the data to be checksummed.
+@param aLength	The length of the data to be checksummed.
+@return         A 32 bit integer contain the CRC value.
+@internalComponent
+@released
+*/
+uint32_t Crc32Slicing8(const void * aPtr, uint32_t aLength)
+{
+	const uint8 * p = (const uint8 *)aPtr;
+	return Crc32Slicing8(0, p, p + aLength);
+}
+
+#ifdef CPU_X86
+/**
+Performs a CCITT CRC-32 checksum on the specified data with carry-less multiplication.
+
+Four 128 bit lanes are folded 64 bytes ahead, then folded into one lane and reduced to
+32 bits with Barrett reduction, as described in Intel's "Fast CRC Computation for Generic
+Polynomials Using PCLMULQDQ Instruction". The constants are for the bit reflected
+polynomial 0xedb88320. Short data and the tail are done by slicing-by-8.
+
+@param aPtr		A pointer to the start of the data to be checksummed.
+@param aLength	The length of the data to be checksummed.
+@return         A 32 bit integer contain the CRC value.
+@internalComponent
+@released
+*/
+TARGET_PCLMUL uint32_t Crc32Clmul(const void * aPtr, uint32_t aLength)
+{
+	const uint8 * p = (const uint8 *)aPtr;
+	const uint8 * q = p + aLength;
+	if (aLength < 64)
+		return Crc32Slicing8(0, p, q);
+
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+	__m128i x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+	__m128i x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+	__m128i x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+	p += 64;
+
+	// fold four lanes 64 bytes ahead
+	while (q - p >= 64)
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+		p += 64;
+	}
+
+	// fold the lanes into one, then the remaining 16 byte blocks into it
+	__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x2);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x3);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x4);
+	while (q - p >= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)p));
+		p += 16;
+	}
+
+	// 128 to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	uint32_t crc = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+	return Crc32Slicing8(crc, p, q);
+}
+#endif
+
+/**
+Performs a CCITT CRC checksum on the specified data.
+
+@param aPtr    A pointer to the start of the data to be checksummed.
+@param aLength The length of the data to be checksummed.
+@return        A 16 bit integer contain the checksummed value.
+@internalComponent
+@released
+*/
+uint16_t Crc(const void * aPtr, uint32_t aLength)
+{
+	return CrcSlicing8(aPtr, aLength);
+}
+
+/**
+Performs a CCITT CRC-32 checksum on the specified data.
+
+The implementation is chosen on the first call from the instructions the CPU has.
+
+@param aPtr		A pointer to the start of the data to be checksummed.
+@param aLength	The length of the data to be checksummed.
+@return         A 32 bit integer contain the CRC value.
+@internalComponent
+@released
+*/
+uint32_t Crc32(const void * aPtr, uint32_t aLength)
+{
+	typedef uint32_t (*TCrc32)(const void * aPtr, uint32_t aLength);
+#ifdef CPU_X86
+	static const TCrc32 crc32 = CpuHasPclmul() ? Crc32Clmul : (TCrc32)Crc32Slicing8;
+#else
+	static const TCrc32 crc32 = Crc32Slicing8;
+#endif
+	return crc32(aPtr, aLength);
+}
@@ -22,10 +22,25 @@
 #define CHECKSUM_H
 
 #include <cstddef>
+#include <stdint.h>
+
+#include "cpufeatures.h"
+
 uint32_t checkSum(const void *aPtr);
+
+// Crc() and Crc32() use the fastest implementation the CPU has, the
+// variants below are exported for the tests.
 uint16_t Crc(const void * aPtr,uint32_t aLength);
 uint32_t Crc32(const void * aPtr, uint32_t aLength);
 
+uint16_t CrcBytes(const void * aPtr, uint32_t aLength);
+uint16_t CrcSlicing8(const void * aPtr, uint32_t aLength);
+uint32_t Crc32Bytes(const void * aPtr, uint32_t aLength);
+uint32_t Crc32Slicing8(const void * aPtr, uint32_t aLength);
+#ifdef CPU_X86
+uint32_t Crc32Clmul(const void * aPtr, uint32_t aLength); // requires CpuHasPclmul()
+#endif
+
 #endif // CHECKSUM_H
 
 
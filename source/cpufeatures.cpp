@@ -0,0 +1,85 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Runtime detection of optional instruction sets for the compression kernels
+// @internalComponent
+// @released
+//
+//
+
+#include "cpufeatures.h"
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+static bool HasAvx2()
+{
+    int regs[4];
+    __cpuid(regs, 0);
+    if(regs[0] < 7)
+        return false;
+    __cpuid(regs, 1);
+    // OSXSAVE and AVX, then the OS must save the YMM registers
+    if((regs[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28))
+        return false;
+    if((_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+}
+#endif
+
+/** True if SSE2 instructions are available. */
+bool CpuHasSse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(CPU_X86) && defined(__GNUC__)
+    return __builtin_cpu_supports("sse2");
+#elif defined(CPU_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[3] & (1 << 26)) != 0;
+#else
+    return false;
+#endif
+}
+
+/** True if the carry-less multiplication instruction PCLMULQDQ is available. */
+bool CpuHasPclmul()
+{
+#if defined(CPU_X86) && defined(__GNUC__)
+    return __builtin_cpu_supports("pclmul");
+#elif defined(CPU_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 1)) != 0;
+#else
+    return false;
+#endif
+}
+
+/** True if AVX2 instructions are available and enabled by the OS. */
+bool CpuHasAvx2()
+{
+#if defined(CPU_X86) && defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(CPU_X86) && defined(_MSC_VER)
+    static const bool hasAvx2 = HasAvx2();
+    return hasAvx2;
+#else
+    return false;
+#endif
+}
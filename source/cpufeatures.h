@@ -0,0 +1,61 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Runtime detection of optional instruction sets for the compression kernels
+// @internalComponent
+// @released
+//
+//
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86 1
+#endif
+
+// Functions using intrinsics of instruction sets not enabled for the whole
+// build must be marked with these, MSVC allows them anyway.
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_PCLMUL __attribute__((target("sse2,pclmul")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_PCLMUL
+#endif
+
+bool CpuHasSse2();
+bool CpuHasAvx2();
+bool CpuHasPclmul();
+
+/** Index of the lowest set bit, aValue must not be zero. */
+inline int LowestBit(uint64_t aValue)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(aValue);
+#else
+    int n = 0;
+    while(!(aValue & 1))
+    {
+        aValue >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+#endif // CPUFEATURES_H
@@ -19,15 +19,37 @@
 #include <algorithm>
 #include <string.h>
 #include <type_traits>
+#include <vector>
 
 #include "errorhandler.h"
 #include "farray.h"
 #include "huffman.h"
+#include "matchlength.h"
+#include "parallel.h"
 
 using std::min;
 
 
-void DeflateL(const TUint8* aBuf, TInt aLength, TBitOutput& aOutput);
+void DeflateL(const TUint8* aBuf, TInt aLength, TBitOutput& aOutput, TInt aLevel, TInt aJobs);
+
+// A recorded token is a literal/length code, or a match flagged with this bit
+// and holding its length in bits 16-30 and its distance in bits 0-15
+const TUint32 KDeflateMatchToken=0x80000000u;
+
+// Longest hash chain Match() walks at every --deflatelevel. A chain never holds
+// more than KDeflateMaxDistance positions, so the last level searches the whole
+// window and gives the same output as the original encoder for data up to
+// KDeflateSegmentSize.
+static const TInt KDeflateChainDepth[KDeflateMaxLevel]={4,8,16,32,64,128,256,1024,KDeflateMaxDistance};
+
+// Most rounds of optimal parsing at KDeflateOptimalLevel, each round prices the
+// symbols with the Huffman code lengths of the previous one
+const TInt KDeflateOptimalPasses=16;
+
+// The match search runs on segments of this size in parallel. Matches end in
+// their segment but may refer to the previous one, the output only depends on
+// the data and not on the number of threads.
+const TInt KDeflateSegmentSize=0x40000;
 
 /**
 Class HDeflateHash
@@ -47,7 +69,7 @@ class HDeflateHash
 	private:
 		typedef TUint16 TOffset;
 	private:
-		TInt iHash[256];
+		TInt iHash[KDeflateHashSize];
 		TOffset iOffset[1];	// or more
 };
 
@@ -59,14 +81,36 @@ Class MDeflater
 class MDeflater
 {
 	public:
-		void DeflateL(const TUint8* aBase,TInt aLength);
+		void DeflateL(const TUint8* aHistory,const TUint8* aBase,TInt aLength,TInt aLevel);
+		void ReplayL(const std::vector<TUint32>& aTokens);
 	private:
-		const TUint8* DoDeflateL(const TUint8* aBase,const TUint8* aEnd,HDeflateHash& aHash);
-		static TInt Match(const TUint8* aPtr,const TUint8* aEnd,TInt aPos,HDeflateHash& aHas);
-		void SegmentL(TInt aLength,TInt aDistance);
+		const TUint8* DoDeflateL(const TUint8* aOrigin,const TUint8* aBase,const TUint8* aEnd,HDeflateHash& aHash,TInt aChain);
+		static TInt Match(const TUint8* aPtr,const TUint8* aEnd,TInt aPos,HDeflateHash& aHas,TInt aChain);
+		virtual void SegmentL(TInt aLength,TInt aDistance);
 		virtual void LitLenL(TInt aCode) =0;
 		virtual void OffsetL(TInt aCode) =0;
 		virtual void ExtraL(TInt aLen,TUint aBits) =0;
+	protected:
+		static inline TInt Code(TUint aValue,TInt& aExtraLen);
+};
+
+/**
+Class TDeflateRecorder
+@internalComponent
+@released
+*/
+class TDeflateRecorder : public MDeflater
+{
+	public:
+		explicit inline TDeflateRecorder(std::vector<TUint32>& aTokens);
+	private:
+		// from MDeflater
+		void SegmentL(TInt aLength,TInt aDistance);
+		void LitLenL(TInt aCode);
+		void OffsetL(TInt aCode);
+		void ExtraL(TInt aLen,TUint aBits);
+	private:
+		std::vector<TUint32>& iTokens;
 };
 
 /**
@@ -106,6 +150,68 @@ class TDeflater : public MDeflater
 		const TEncoding& iEncoding;
 };
 
+/**
+Class TDeflateCost
+@internalComponent
+@released
+*/
+class TDeflateCost : public MDeflater
+{
+	public:
+		explicit inline TDeflateCost(const TEncoding& aLengths);
+		inline TUint Bits() const;
+		static void PriceL(const TEncoding& aLengths,TUint32 aLitLen[],TUint32 aLength[],TUint32 aDistance[]);
+	private:
+		// from MDeflater
+		void LitLenL(TInt aCode);
+		void OffsetL(TInt aCode);
+		void ExtraL(TInt aLen,TUint aBits);
+	private:
+		const TEncoding& iLengths;
+		TUint iBits;
+};
+
+/**
+Class TBitCounter
+@internalComponent
+@released
+*/
+class TBitCounter : public TBitOutput
+{
+	enum {KBufSize=0x100};
+	public:
+		inline TBitCounter();
+		inline TUint Bits() const;
+	private:
+		void OverflowL();
+	private:
+		TUint iBytes;
+		TUint8 iBuf[KBufSize];
+};
+
+/**
+Class TDeflateOptimiser
+@internalComponent
+@released
+*/
+class TDeflateOptimiser
+{
+	public:
+		TDeflateOptimiser(const TUint8* aHistory,const TUint8* aBase,TInt aLength);
+		static void OptimiseL(std::vector<TDeflateOptimiser>& aSegments,std::vector<std::vector<TUint32> >& aTokens,TInt aJobs);
+	private:
+		void FindMatchesL();
+		void ParseL(const TEncoding& aLengths,std::vector<TUint32>& aTokens) const;
+		static void LengthsL(const std::vector<std::vector<TUint32> >& aTokens,TEncoding& aLengths);
+		static TUint SizeL(const std::vector<std::vector<TUint32> >& aTokens,const TEncoding& aLengths);
+	private:
+		const TUint8* iHistory;
+		const TUint8* iBase;
+		TInt iLength;
+		std::vector<TInt> iFirst;		// the matches at position i are iMatches[iFirst[i]..iFirst[i+1])
+		std::vector<TUint32> iMatches;	// length<<16|distance, each longer than the one before
+};
+
 
 /**
 Constructor for class HDeflateHash
@@ -113,7 +219,7 @@ Constructor for class HDeflateHash
 @released
 */
 inline HDeflateHash::HDeflateHash()
-{TInt* p=iHash+256;do *--p=-KDeflateMaxDistance-1; while (p>iHash);}
+{TInt* p=iHash+KDeflateHashSize;do *--p=-KDeflateMaxDistance-1; while (p>iHash);}
 
 /**
 @Leave - OutOfMemory
@@ -127,7 +233,8 @@ inline HDeflateHash* HDeflateHash::NewLC(TInt aLinks)
 {
 #if __GNUC__ >= 4 || _MSC_VER
 	// Try to detect if the class' layout has changed.
-	static_assert( sizeof(HDeflateHash) == 1028, "sizeof(HDeflateHash) != 1028" );
+	static_assert( sizeof(HDeflateHash) == sizeof(TInt) * (KDeflateHashSize + 1),
+               "sizeof(HDeflateHash) != sizeof(TInt) * (KDeflateHashSize + 1)" );
 	static_assert( sizeof(TOffset) == 2, "sizeof(TOffset) != 2" );
 	static_assert( offsetof(HDeflateHash, iHash) < offsetof(HDeflateHash, iOffset),
                "offsetof(HDeflateHash, iHash) !< offsetof(HDeflateHash, iOffset)" );
@@ -135,7 +242,7 @@ inline HDeflateHash* HDeflateHash::NewLC(TInt aLinks)
 	// Compute the size of the class, including rounding it up to a multiple of 4
 	// bytes.
 
-	unsigned n = sizeof(TInt) * 256 + sizeof(TOffset) * (min)(aLinks, KDeflateMaxDistance);
+	unsigned n = sizeof(TInt) * KDeflateHashSize + sizeof(TOffset) * (min)(aLinks, KDeflateMaxDistance);
 
 	while (n & 0x1f)
 	{
@@ -202,10 +309,11 @@ Function Match
 @param aEnd
 @param aPos
 @param aHash
+@param aChain - the number of earlier positions to try at most
 @internalComponent
 @released
 */
-TInt MDeflater::Match(const TUint8* aPtr,const TUint8* aEnd,TInt aPos,HDeflateHash& aHash)
+TInt MDeflater::Match(const TUint8* aPtr,const TUint8* aEnd,TInt aPos,HDeflateHash& aHash,TInt aChain)
 {
 	TInt offset=aHash.First(aPtr,aPos);
 	if (offset>KDeflateMaxDistance)
@@ -218,43 +326,38 @@ TInt MDeflater::Match(const TUint8* aPtr,const TUint8* aEnd,TInt aPos,HDeflateHa
 		const TUint8* p=aPtr-offset;
 		if (p[match>>16]==c)
 		{	// might be a better match
-			const TUint8* m=aPtr;
-			for (;;)
-			{
-				if (*p++!=*m++)
-					break;
-				if (m<aEnd)
-					continue;
-				return ((m-aPtr)<<16)|offset;
-			}
-			TInt left=m-aPtr-1;
-			if (left>match>>16)
+			TInt len=MatchLength(aPtr,p,aEnd);
+			if (aPtr+len==aEnd)
+				return (len<<16)|offset;
+			if (len>match>>16)
 			{
-				match=(left<<16)|offset;
-				c=m[-1];
+				match=(len<<16)|offset;
+				c=aPtr[len];
 			}
 		}
 		offset=aHash.Next(aPos,offset);
-	} while (offset<=KDeflateMaxDistance);
+	} while (offset<=KDeflateMaxDistance && --aChain>0);
 	return match;
 }
 
 /*
 Apply the deflation algorithm to the data [aBase,aEnd)
 Return a pointer after the last byte that was deflated (which may not be aEnd)
+@param aOrigin - the position aHash counts from
 @param aBase
 @param aEnd
 @param aHash
+@param aChain
 @internalComponent
 @released
 */
-const TUint8* MDeflater::DoDeflateL(const TUint8* aBase,const TUint8* aEnd,HDeflateHash& aHash)
+const TUint8* MDeflater::DoDeflateL(const TUint8* aOrigin,const TUint8* aBase,const TUint8* aEnd,HDeflateHash& aHash,TInt aChain)
 {
 	const TUint8* ptr=aBase;
 	TInt prev=0;		// the previous deflation match
 	do
 	{
-		TInt match=Match(ptr,aEnd,ptr-aBase,aHash);
+		TInt match=Match(ptr,aEnd,ptr-aOrigin,aHash,aChain);
 // Extra deflation applies two optimisations which double the time taken
 // 1. If we have a match at p, then test for a better match at p+1 before using it
 // 2. When we have a match, add the hash links for all the data which will be skipped
@@ -268,7 +371,7 @@ const TUint8* MDeflater::DoDeflateL(const TUint8* aBase,const TUint8* aEnd,HDefl
 			{
 				++ptr;
 				if (ptr + 2 < aEnd)
-				  aHash.First(ptr,ptr-aBase);
+				  aHash.First(ptr,ptr-aOrigin);
 			} while (ptr<e);
 			prev=0;
 		}
@@ -292,25 +395,47 @@ const TUint8* MDeflater::DoDeflateL(const TUint8* aBase,const TUint8* aEnd,HDefl
 }
 
 /*
-The generic deflation algorithm
+The generic deflation algorithm, the caller adds the eos marker after the last segment
+@param aHistory - the start of the earlier data that matches can refer to
 @param aBase
 @param aLength
+@param aLevel - 1 to KDeflateMaxLevel, higher levels search longer hash chains.
+KDeflateOptimalLevel is handled by DoDeflateL()
 @internalComponent
 @released
 */
-void MDeflater::DeflateL(const TUint8* aBase,TInt aLength)
+void MDeflater::DeflateL(const TUint8* aHistory,const TUint8* aBase,TInt aLength,TInt aLevel)
 {
 	const TUint8* end=aBase+aLength;
 	if (aLength>KDeflateMinLength)
 	{	// deflation kicks in if there is enough data
-		HDeflateHash* hash=HDeflateHash::NewLC(aLength);
+		HDeflateHash* hash=HDeflateHash::NewLC(end-aHistory);
+		for (const TUint8* p=aHistory;p<aBase;++p)
+			hash->First(p,p-aHistory);
 
-		aBase=DoDeflateL(aBase,end,*hash);
+		aBase=DoDeflateL(aHistory,aBase,end,*hash,KDeflateChainDepth[aLevel-1]);
 		delete hash;
 	}
 	while (aBase<end)					// emit remaining bytes
 		LitLenL(*aBase++);
-	LitLenL(TEncoding::EEos);	// eos marker
+}
+
+/*
+Feed the tokens recorded by TDeflateRecorder to LitLenL() and SegmentL(), in the
+same order as DeflateL() would for the same data
+@param aTokens
+@internalComponent
+@released
+*/
+void MDeflater::ReplayL(const std::vector<TUint32>& aTokens)
+{
+	for (TUint32 token : aTokens)
+	{
+		if (token&KDeflateMatchToken)
+			SegmentL((token>>16)&0x7fff,token&0xffff);
+		else
+			LitLenL(token);
+	}
 }
 
 /*
@@ -324,30 +449,88 @@ LitLen(), Offset() and Extra() functions.
 void MDeflater::SegmentL(TInt aLength,TInt aDistance)
 {
 	aLength-=KDeflateMinLength;
-	TInt extralen=0;
-	TUint len=aLength;
-	while (len>=8)
-	{
-		++extralen;
-		len>>=1;
-	}
-	LitLenL((extralen<<2)+len+TEncoding::ELiterals);
+	TInt extralen;
+	LitLenL(Code(aLength,extralen)+TEncoding::ELiterals);
 	if (extralen)
 		ExtraL(extralen,aLength);
 //
 	aDistance--;
-	extralen=0;
-	TUint dist=aDistance;
-	while (dist>=8)
-	{
-		++extralen;
-		dist>>=1;
-	}
-	OffsetL((extralen<<2)+dist);
+	OffsetL(Code(aDistance,extralen));
 	if (extralen)
 		ExtraL(extralen,aDistance);
 }
 
+/*
+Split a match length or distance into its code and the number of extra bits
+@param aValue - length-KDeflateMinLength or distance-1
+@param aExtraLen - receives the number of extra bits
+@return the length or distance code
+@internalComponent
+@released
+*/
+inline TInt MDeflater::Code(TUint aValue,TInt& aExtraLen)
+{
+	aExtraLen=0;
+	while (aValue>=8)
+	{
+		++aExtraLen;
+		aValue>>=1;
+	}
+	return (aExtraLen<<2)+aValue;
+}
+
+/**
+Class TDeflateRecorder
+This class saves the result of the match search, so it can be replayed for
+the statistics and for the encoder
+@internalComponent
+@released
+*/
+inline TDeflateRecorder::TDeflateRecorder(std::vector<TUint32>& aTokens)
+	:iTokens(aTokens)
+	{}
+
+/*
+Function SegmentL
+@param aLength
+@param aDistance
+@internalComponent
+@released
+*/
+void TDeflateRecorder::SegmentL(TInt aLength,TInt aDistance)
+	{
+	iTokens.push_back(KDeflateMatchToken|(aLength<<16)|aDistance);
+	}
+
+/*
+Function LitLenL
+@param aCode
+@internalComponent
+@released
+*/
+void TDeflateRecorder::LitLenL(TInt aCode)
+	{
+	iTokens.push_back(aCode);
+	}
+
+/*
+Function OffsetL
+Not called, SegmentL() records the whole match
+@internalComponent
+@released
+*/
+void TDeflateRecorder::OffsetL(TInt)
+	{}
+
+/*
+Function ExtraL
+Not called, SegmentL() records the whole match
+@internalComponent
+@released
+*/
+void TDeflateRecorder::ExtraL(TInt,TUint)
+	{}
+
 /**
 Class TDeflateStats
 This class analyses the data stream to generate the frequency tables
@@ -439,6 +622,321 @@ void TDeflater::ExtraL(TInt aLen,TUint aBits)
 	{
 	iOutput.WriteL(aBits,aLen);
 	}
+/**
+Constructor of Class TDeflateCost
+Extends MDeflater to count the bits the huffman encoding of the data takes
+@param aLengths - the code lengths generated by Huffman::HuffmanL()
+@internalComponent
+@released
+*/
+inline TDeflateCost::TDeflateCost(const TEncoding& aLengths)
+	:iLengths(aLengths),iBits(0)
+	{}
+
+/*
+Function Bits
+@return the number of bits counted
+@internalComponent
+@released
+*/
+inline TUint TDeflateCost::Bits() const
+	{
+	return iBits;
+	}
+
+/*
+Function LitLenL
+@param aCode
+@internalComponent
+@released
+*/
+void TDeflateCost::LitLenL(TInt aCode)
+	{
+	iBits+=iLengths.iLitLen[aCode];
+	}
+
+/*
+Function OffsetL
+@param aCode
+@internalComponent
+@released
+*/
+void TDeflateCost::OffsetL(TInt aCode)
+	{
+	iBits+=iLengths.iDistance[aCode];
+	}
+
+/*
+Function ExtraL
+@param aLen
+@internalComponent
+@released
+*/
+void TDeflateCost::ExtraL(TInt aLen,TUint)
+	{
+	iBits+=aLen;
+	}
+
+/*
+Function PriceL
+Price every literal, match length and match distance in bits, including the
+extra bits. A code which is not in use is priced one bit longer than the
+longest code of its table, so the parser can still choose it.
+@param aLengths - the code lengths generated by Huffman::HuffmanL()
+@param aLitLen - receives the price of the TEncoding::ELiterals literals
+@param aLength - receives the price of the lengths up to KDeflateMaxLength
+@param aDistance - receives the price of the distances up to KDeflateMaxDistance
+@internalComponent
+@released
+*/
+void TDeflateCost::PriceL(const TEncoding& aLengths,TUint32 aLitLen[],TUint32 aLength[],TUint32 aDistance[])
+	{
+	TUint32 litlen[TEncoding::ELitLens];
+	TUint32 distance[TEncoding::EDistances];
+	TUint32 unused=*std::max_element(aLengths.iLitLen,aLengths.iLitLen+TEncoding::ELitLens)+1;
+	for (TInt i=0;i<TEncoding::ELitLens;++i)
+		litlen[i]=aLengths.iLitLen[i] ? aLengths.iLitLen[i] : unused;
+	unused=*std::max_element(aLengths.iDistance,aLengths.iDistance+TEncoding::EDistances)+1;
+	for (TInt i=0;i<TEncoding::EDistances;++i)
+		distance[i]=aLengths.iDistance[i] ? aLengths.iDistance[i] : unused;
+
+	std::copy(litlen,litlen+TEncoding::ELiterals,aLitLen);
+	TInt extralen;
+	for (TInt len=KDeflateMinLength;len<=KDeflateMaxLength;++len)
+		aLength[len]=litlen[Code(len-KDeflateMinLength,extralen)+TEncoding::ELiterals]+extralen;
+	for (TInt dist=1;dist<=KDeflateMaxDistance;++dist)
+		aDistance[dist]=distance[Code(dist-1,extralen)]+extralen;
+	}
+
+/**
+Constructor of Class TBitCounter
+Counts the bits written to it instead of keeping them
+@internalComponent
+@released
+*/
+inline TBitCounter::TBitCounter()
+	:iBytes(0)
+	{}
+
+/*
+Function Bits
+@return the number of bits written so far
+@internalComponent
+@released
+*/
+inline TUint TBitCounter::Bits() const
+	{
+	TUint bytes=iBytes;
+	if (Ptr())
+		bytes+=Ptr()-iBuf;
+	return bytes*8+BufferedBits();
+	}
+
+/*
+Function OverflowL
+@internalComponent
+@released
+*/
+void TBitCounter::OverflowL()
+	{
+	if (Ptr())
+		iBytes+=Ptr()-iBuf;
+	Set(iBuf,KBufSize);
+	}
+
+/**
+Constructor of Class TDeflateOptimiser
+Cost based optimal parsing of the data: every round finds the cheapest sequence
+of literals and matches for the code lengths of the previous round
+@param aHistory - the start of the earlier data that matches can refer to
+@param aBase
+@param aLength
+@internalComponent
+@released
+*/
+TDeflateOptimiser::TDeflateOptimiser(const TUint8* aHistory,const TUint8* aBase,TInt aLength)
+	:iHistory(aHistory),iBase(aBase),iLength(aLength)
+	{}
+
+/*
+Function FindMatchesL
+Walk the whole hash chain at every position and record each match that is
+longer than all the closer ones. The parser gets only the closest match of
+every length. That is a heuristic as in zopfli, not optimal: with distances
+priced by their Huffman codes a farther distance may have a shorter code.
+@internalComponent
+@released
+*/
+void TDeflateOptimiser::FindMatchesL()
+	{
+	iFirst.assign(iLength+1,0);
+	iMatches.clear();
+	iMatches.reserve(iLength);
+	const TUint8* end=iBase+iLength;
+	HDeflateHash* hash=HDeflateHash::NewLC(end-iHistory);
+	for (const TUint8* p=iHistory;p<iBase;++p)
+		hash->First(p,p-iHistory);
+	for (TInt pos=0;pos<iLength;++pos)
+		{
+		iFirst[pos]=iMatches.size();
+		const TUint8* ptr=iBase+pos;
+		if (ptr+KDeflateMinLength>end)
+			continue;
+		TInt maxlen=(min)(TInt(end-ptr),KDeflateMaxLength);
+		TInt best=KDeflateMinLength-1;
+		TInt hpos=ptr-iHistory;
+		for (TInt offset=hash->First(ptr,hpos);offset<=KDeflateMaxDistance;offset=hash->Next(hpos,offset))
+			{
+			const TUint8* p=ptr-offset;
+			if (p[best]!=ptr[best])
+				continue;
+			TInt len=MatchLength(ptr,p,ptr+maxlen);
+			if (len>best)
+				{
+				best=len;
+				iMatches.push_back((len<<16)|offset);
+				if (len==maxlen)
+					break;
+				}
+			}
+		}
+	iFirst[iLength]=iMatches.size();
+	delete hash;
+	}
+
+/*
+Function ParseL
+Find the cheapest way to encode the data with the given code lengths
+@param aLengths - the code lengths generated by Huffman::HuffmanL()
+@param aTokens - receives the tokens as recorded by TDeflateRecorder
+@internalComponent
+@released
+*/
+void TDeflateOptimiser::ParseL(const TEncoding& aLengths,std::vector<TUint32>& aTokens) const
+	{
+	TUint32 litlen[TEncoding::ELiterals];
+	TUint32 length[KDeflateMaxLength+1];
+	TUint32 distance[KDeflateMaxDistance+1];
+	TDeflateCost::PriceL(aLengths,litlen,length,distance);
+
+	std::vector<TUint32> costs(iLength+1,~0u);	// bits to encode the data up to position i
+	std::vector<TUint32> steps(iLength+1);		// the literal or match which ends at position i
+	costs[0]=0;
+	for (TInt pos=0;pos<iLength;++pos)
+		{
+		TUint32 cost=costs[pos];
+		TUint32 c=cost+litlen[iBase[pos]];
+		if (c<costs[pos+1])
+			{
+			costs[pos+1]=c;
+			steps[pos+1]=1<<16;
+			}
+		TInt len=KDeflateMinLength;
+		for (TInt i=iFirst[pos];i<iFirst[pos+1];++i)
+			{
+			TInt dist=iMatches[i]&0xffff;
+			TInt last=iMatches[i]>>16;
+			TUint32 base=cost+distance[dist];
+			for (;len<=last;++len)
+				{
+				c=base+length[len];
+				if (c<costs[pos+len])
+					{
+					costs[pos+len]=c;
+					steps[pos+len]=(len<<16)|dist;
+					}
+				}
+			}
+		}
+
+	// walk the cheapest path back from the end and store it forward
+	aTokens.clear();
+	for (TInt pos=iLength;pos>0;pos-=steps[pos]>>16)
+		aTokens.push_back(steps[pos]);
+	std::reverse(aTokens.begin(),aTokens.end());
+	TInt pos=0;
+	for (TUint32& token : aTokens)
+		{
+		TInt len=token>>16;
+		token=(len==1) ? iBase[pos] : (token|KDeflateMatchToken);
+		pos+=len;
+		}
+	}
+
+/*
+Function LengthsL
+@param aTokens
+@param aLengths - receives the huffman code lengths for the tokens
+@internalComponent
+@released
+*/
+void TDeflateOptimiser::LengthsL(const std::vector<std::vector<TUint32> >& aTokens,TEncoding& aLengths)
+	{
+	aLengths=TEncoding();
+	TDeflateStats analyser(aLengths);
+	for (const std::vector<TUint32>& tokens : aTokens)
+		analyser.ReplayL(tokens);
+	Huffman::HuffmanL(aLengths.iLitLen,TEncoding::ELitLens,aLengths.iLitLen);
+	Huffman::HuffmanL(aLengths.iDistance,TEncoding::EDistances,aLengths.iDistance);
+	}
+
+/*
+Function SizeL
+@param aTokens
+@param aLengths - the huffman code lengths for the tokens
+@return the number of bits the tokens take, including the encoding table
+@internalComponent
+@released
+*/
+TUint TDeflateOptimiser::SizeL(const std::vector<std::vector<TUint32> >& aTokens,const TEncoding& aLengths)
+	{
+	TBitCounter table;
+	Huffman::ExternalizeL(table,aLengths.iLitLen,KDeflationCodes);
+	TDeflateCost data(aLengths);
+	for (const std::vector<TUint32>& tokens : aTokens)
+		data.ReplayL(tokens);
+	return table.Bits()+data.Bits();
+	}
+
+/*
+Function OptimiseL
+Improve on the tokens of the match search until a round gives no smaller
+output. The rounds start from the code lengths of aTokens, every round parses
+the segments in parallel with the same code lengths.
+@param aSegments
+@param aTokens - the tokens of every segment followed by the eos marker,
+receives the best ones found
+@param aJobs - the number of threads, see ParallelFor()
+@internalComponent
+@released
+*/
+void TDeflateOptimiser::OptimiseL(std::vector<TDeflateOptimiser>& aSegments,std::vector<std::vector<TUint32> >& aTokens,TInt aJobs)
+	{
+	ParallelFor(aSegments.size(),aJobs,[&](int aIndex,int)
+		{
+		aSegments[aIndex].FindMatchesL();
+		});
+	TEncoding lengths;
+	LengthsL(aTokens,lengths);
+	TUint best=SizeL(aTokens,lengths);
+	std::vector<std::vector<TUint32> > tokens(aTokens);
+	for (TInt pass=0;pass<KDeflateOptimalPasses;++pass)
+		{
+		ParallelFor(aSegments.size(),aJobs,[&](int aIndex,int)
+			{
+			aSegments[aIndex].ParseL(lengths,tokens[aIndex]);
+			});
+		TEncoding next;
+		LengthsL(tokens,next);
+		TUint size=SizeL(tokens,next);
+		if (size>=best)
+			break;
+		best=size;
+		aTokens.swap(tokens);
+		lengths=next;
+		}
+	}
+
 /*
 Function DoDeflateL
 @Leave
@@ -446,14 +944,53 @@ Function DoDeflateL
 @param aLength
 @param aOutput
 @param aEncoding
+@param aLevel
+@param aJobs
 @internalComponent
 @released
 */
-void DoDeflateL(const TUint8* aBuf,TInt aLength,TBitOutput& aOutput,TEncoding& aEncoding)
+void DoDeflateL(const TUint8* aBuf,TInt aLength,TBitOutput& aOutput,TEncoding& aEncoding,TInt aLevel,TInt aJobs)
 	{
-// analyse the data for symbol frequency
-	TDeflateStats analyser(aEncoding);
-	analyser.DeflateL(aBuf,aLength);
+// search the matches once per segment, both passes below replay the result
+	TInt segments=(aLength+KDeflateSegmentSize-1)/KDeflateSegmentSize;
+	std::vector<std::vector<TUint32> > tokens(segments+1);
+	ParallelFor(segments,aJobs,[&](int aIndex,int)
+		{
+		const TUint8* base=aBuf+aIndex*KDeflateSegmentSize;
+		TInt length=(min)(KDeflateSegmentSize,TInt(aBuf+aLength-base));
+		tokens[aIndex].reserve(length/4+1);
+		TDeflateRecorder recorder(tokens[aIndex]);
+		recorder.DeflateL(base-(min)(TInt(base-aBuf),KDeflateMaxDistance),base,length,(min)(aLevel,KDeflateMaxLevel));
+		});
+	tokens[segments].push_back(TEncoding::EEos);	// eos marker
+
+	if (aLevel==KDeflateOptimalLevel)
+		{
+		std::vector<TDeflateOptimiser> optimisers;
+		for (TInt i=0;i<segments;++i)
+			{
+			const TUint8* base=aBuf+i*KDeflateSegmentSize;
+			optimisers.push_back(TDeflateOptimiser(base-(min)(TInt(base-aBuf),KDeflateMaxDistance),base,
+				(min)(KDeflateSegmentSize,TInt(aBuf+aLength-base))));
+			}
+		TDeflateOptimiser::OptimiseL(optimisers,tokens,aJobs);
+		}
+
+// analyse the data for symbol frequency, the segments are counted in parallel
+// and their frequencies added up
+	std::vector<TEncoding> stats(tokens.size());
+	ParallelFor(tokens.size(),aJobs,[&](int aIndex,int)
+		{
+		TDeflateStats analyser(stats[aIndex]);
+		analyser.ReplayL(tokens[aIndex]);
+		});
+	for (const TEncoding& part : stats)
+		{
+		for (TInt i=0;i<TEncoding::ELitLens;++i)
+			aEncoding.iLitLen[i]+=part.iLitLen[i];
+		for (TInt i=0;i<TEncoding::EDistances;++i)
+			aEncoding.iDistance[i]+=part.iDistance[i];
+		}
 
 // generate the required huffman encodings
 	Huffman::HuffmanL(aEncoding.iLitLen,TEncoding::ELitLens,aEncoding.iLitLen);
@@ -468,7 +1005,8 @@ void DoDeflateL(const TUint8* aBuf,TInt aLength,TBitOutput& aOutput,TEncoding& a
 
 // now finally deflate the data with the generated encoding
 	TDeflater deflater(aOutput,aEncoding);
-	deflater.DeflateL(aBuf,aLength);
+	for (const std::vector<TUint32>& part : tokens)
+		deflater.ReplayL(part);
 	aOutput.PadL(1);
 	}
 
@@ -478,29 +1016,48 @@ Function DeflateL
 @param aBuf
 @param aLength
 @param aOutput
+@param aLevel
+@param aJobs
 @internalComponent
 @released
 */
-void DeflateL(const TUint8* aBuf, TInt aLength, TBitOutput& aOutput)
+void DeflateL(const TUint8* aBuf, TInt aLength, TBitOutput& aOutput, TInt aLevel, TInt aJobs)
 	{
 	TEncoding* encoding=new TEncoding();
-	DoDeflateL(aBuf,aLength,aOutput,*encoding);
+	DoDeflateL(aBuf,aLength,aOutput,*encoding,aLevel,aJobs);
 	delete encoding;
 	}
 /*
 Function DeflateCompress
 @param bytes
 @param size
+@param aOut - the compressed data is appended to it
+@param aLevel - see MDeflater::DeflateL()
+@param aJobs - the number of threads, see ParallelFor()
+@internalComponent
+@released
+*/
+void DeflateCompress(char *bytes,size_t size, std::vector<TUint8> & aOut, int aLevel, int aJobs)
+	{
+	TMemoryOutput output(aOut);
+	DeflateL((TUint8*)bytes,size,output,aLevel,aJobs);
+	output.FlushL();
+	}
+/*
+Function DeflateCompress
+The data is compressed in memory and written at once
+@param bytes
+@param size
 @param os
+@param aLevel - see MDeflater::DeflateL()
+@param aJobs - the number of threads, see ParallelFor()
 @internalComponent
 @released
 */
-void DeflateCompress(char *bytes,size_t size, std::ofstream & os)
+void DeflateCompress(char *bytes,size_t size, std::ofstream & os, int aLevel, int aJobs)
 	{
-	TFileOutput* output=new TFileOutput(os);
-	output->iDataCount = 0;
-	DeflateL((TUint8*)bytes,size,*output);
-	output->FlushL();
-	delete output;
+	std::vector<TUint8> out;
+	DeflateCompress(bytes,size,out,aLevel,aJobs);
+	os.write(reinterpret_cast<char *>(out.data()),out.size());
 	}
 
@@ -21,7 +21,6 @@
 
 #include "pl_elfimage.h"
 #include "pl_elfexports.h"
-#include "pl_elflocalrelocation.h"
 #include "pl_symbol.h"
 
 /**
@@ -89,10 +88,9 @@ void E32ExportTable::CreateExportTable(ElfImage * aElfImage)
 		}
 		// set up the pointer
 		iTable[i] = ptr;
-		ElfLocalRelocation * aRel = new ElfLocalRelocation(iElfImage,
-                iExportTableAddress, 0, i, R_ARM_ABS32, nullptr, ESegmentRO, sym, aDelSym);
 	    aPlace++;
-	    iElfImage->AddToLocalRelocations(aRel);
+	    iElfImage->AddToLocalRelocations(iExportTableAddress, R_ARM_ABS32, sym, ESegmentRO,
+                false, aDelSym);
 	}
 }
 
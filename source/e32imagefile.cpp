@@ -24,6 +24,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <cassert>
 #include <iostream>
 #ifndef __LINUX__
@@ -43,7 +44,9 @@
 #include "pl_elfimports.h"
 #include "elffilesupplied.h"
 #include "parametermanager.h"
-#include "pl_elflocalrelocation.h"
+#include "pagedcompress.h"
+#include "pagecache.h"
+#include "pl_elfrelocation.h"
 
 using namespace std;
 
@@ -52,7 +55,7 @@ struct E32RelocPageDesc {
     uint32_t aSize;
 };
 
-void CreateRelocations(ElfRelocations::Relocations & aRelocations, char * & aRelocs, size_t & aRelocsSize);
+void CreateRelocations(ElfImage * aElfImage, ElfRelocations::Relocations & aRelocations, char * & aRelocs, size_t & aRelocsSize);
 size_t RelocationsSize(ElfRelocations::Relocations & aRelocs);
 uint16 GetE32RelocType(ElfRelocation * aReloc);
 
@@ -418,8 +421,8 @@ This function processes Code and Data relocations.
 */
 void E32ImageFile::ProcessRelocations()
 {
-	CreateRelocations(iElfImage->GetCodeRelocations(), iCodeRelocs, iCodeRelocsSize);
-	CreateRelocations(iElfImage->GetDataRelocations(), iDataRelocs, iDataRelocsSize);
+	CreateRelocations(iElfImage, iElfImage->GetCodeRelocations(), iCodeRelocs, iCodeRelocsSize);
+	CreateRelocations(iElfImage, iElfImage->GetDataRelocations(), iDataRelocs, iDataRelocsSize);
 }
 
 /**
@@ -428,14 +431,14 @@ ELF form to E32 form.
 @internalComponent
 @released
 */
-void CreateRelocations(ElfRelocations::Relocations & aRelocations, char * & aRelocs, size_t & aRelocsSize)
+void CreateRelocations(ElfImage * aElfImage, ElfRelocations::Relocations & aRelocations, char * & aRelocs, size_t & aRelocsSize)
 {
 	size_t rsize = RelocationsSize(aRelocations);
 	if (rsize)
 	{
 		aRelocsSize = Align(rsize + sizeof(E32RelocSection), sizeof(uint32));
 
-		uint32 aBase = (*aRelocations.begin())->iSegment->p_vaddr;
+		uint32 aBase = aElfImage->Segment(aRelocations.iSegmentType)->p_vaddr;
 		//add for cleanup to be done later..
 		aRelocs = new char[aRelocsSize]();
 		E32RelocSection * e32reloc = (E32RelocSection * )aRelocs;
@@ -445,10 +448,10 @@ void CreateRelocations(ElfRelocations::Relocations & aRelocations, char * & aRel
 
 		int page = -1;
 		int pagesize = sizeof(E32RelocPageDesc);
-		for (auto r: aRelocations)
+		for (size_t i = 0; i < aRelocations.size(); i++)
 		{
-			ElfLocalRelocation * aReloc = r;
-			int p = aReloc->iAddr & 0xfffff000;
+			uint32 aAddr = aRelocations.iAddr[i];
+			int p = aAddr & 0xfffff000;
 			if (page != p)
 			{
 				if (pagesize%4 != 0)
@@ -464,8 +467,8 @@ void CreateRelocations(ElfRelocations::Relocations & aRelocations, char * & aRel
 				startofblock = (E32RelocPageDesc *)data;
 				data = (uint16 *)(startofblock + 1);
 			}
-			uint16 relocType = aReloc->Fixup();
-			*data++ = (uint16)((aReloc->iAddr & 0xfff) | relocType);
+			uint16 relocType = aRelocations.Fixup(aElfImage, i);
+			*data++ = (uint16)((aAddr & 0xfff) | relocType);
 			pagesize += sizeof(uint16);
 		}
 		if (pagesize%4 != 0)
@@ -492,9 +495,9 @@ size_t RelocationsSize(ElfRelocations::Relocations & relocs)
 {
 	size_t bytecount = 0;
 	int page = -1;
-	for(auto x: relocs)
+	for(auto x: relocs.iAddr)
 	{
-		int p = x->iAddr & 0xfffff000;
+		int p = x & 0xfffff000;
 		if (page != p)
 			{
 			if (bytecount%4 != 0)
@@ -1104,20 +1107,12 @@ This function deflates the compressed data.
 @param bytes
 @param size
 @param os
+@param aLevel
+@param aJobs
 @internalComponent
 @released
 */
-void DeflateCompress(char* bytes, size_t size, ofstream & os);
-
-/**
-This function Paged Pack the compressed data.
-@param bytes
-@param size
-@param os
-@internalComponent
-@released
-*/
-void CompressPages(TUint8 * bytes, TInt size, ofstream& os);
+void DeflateCompress(char* bytes, size_t size, ofstream & os, int aLevel, int aJobs);
 
 
 /**
@@ -1139,23 +1134,30 @@ bool E32ImageFile::WriteImage(const char * aName)
 			size_t aHeaderSize = GetExtendedE32ImageHeaderSize();
 			size_t aBodySize = GetE32ImageSize() - aHeaderSize;
 			os->write(iE32Image, aHeaderSize);
-			DeflateCompress(iE32Image + aHeaderSize, aBodySize, *os);
+			DeflateCompress(iE32Image + aHeaderSize, aBodySize, *os, iManager->DeflateLevel(), iManager->Jobs());
 		}
 		else if (compression == KUidCompressionBytePair)
 		{
 			size_t aHeaderSize = GetExtendedE32ImageHeaderSize();
 			os->write(iE32Image, aHeaderSize);
 
+			std::unique_ptr<PageCache> cache;
+			if(iManager->PageCacheDir())
+				cache.reset(new PageCache(iManager->PageCacheDir(), (uint64_t)iManager->PageCacheSize() << 20));
+
 			// Compress and write out code part
 			int offset = GetExtendedE32ImageHeaderSize();
-			CompressPages( (TUint8*)iE32Image + offset, iHdr->iCodeSize, *os);
+			CompressPages( (TUint8*)iE32Image + offset, iHdr->iCodeSize, *os, iManager->Jobs(), iManager->PageStats(), cache.get());
 
 
 			// Compress and write out data part
 			offset += iHdr->iCodeSize;
 			int srcLen = GetE32ImageSize() - offset;
 
-			CompressPages((TUint8*)iE32Image + offset, srcLen, *os);
+			CompressPages((TUint8*)iE32Image + offset, srcLen, *os, iManager->Jobs(), iManager->PageStats(), cache.get());
+
+			if(cache)
+				cache->Close(iManager->PageStats());
 
 		}
 		else if (compression == 0)
@@ -1191,16 +1193,11 @@ E32ImageFile::~E32ImageFile()
 	delete [] iImportSection;
 }
 
-int DecompressPages(TUint8 * bytes, ifstream& is);
-
 void E32ImageFile::ProcessSymbolInfo()
 {
     Elf32_Addr elfAddr = iTable->iExportTableAddress - 4;// This location points to 0th ord.
 	// Create a relocation entry for the 0th ordinal.
-	ElfLocalRelocation *rel = new ElfLocalRelocation(iElfImage, elfAddr, 0, 0, R_ARM_ABS32,
-		nullptr, ESegmentRO, nullptr, false);
-
-	iElfImage->AddToLocalRelocations(rel);
+	iElfImage->AddToLocalRelocations(elfAddr, R_ARM_ABS32, nullptr, ESegmentRO);
 
 	elfAddr += iTable->GetExportTableSize();// aPlace now points to the symInfo
 	uint32 *aZerothOrd = iTable->GetExportTable();
@@ -1242,10 +1239,8 @@ void E32ImageFile::ProcessSymbolInfo()
 			iSymbolNames.append(aPad, align);
 		}
 		//Create a relocation entry...
-		rel = new ElfLocalRelocation(iElfImage, elfAddr, 0, 0, R_ARM_ABS32, nullptr,
-			ESegmentRO, x->iElfSym, false);
+		iElfImage->AddToLocalRelocations(elfAddr, R_ARM_ABS32, x->iElfSym, ESegmentRO);
 		elfAddr += sizeof(uint32);
-		iElfImage->AddToLocalRelocations(rel);
 	}
 }
 
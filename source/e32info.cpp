@@ -577,6 +577,7 @@ void E32Info::Run()
     printf("E32ImageFile \'%s\'\n", iE32File);
 
     iE32 = new E32Parser(iE32File);
+    iE32->SetJobs(iParam->Jobs());
     iHdr1 = iE32->GetFileLayout();
 
     ValidateE32Image(iE32->GetBufferedImage(), iE32->GetFileSize());
@@ -20,11 +20,13 @@
 #include <fstream>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include "message.h"
 #include "e32common.h"
 #include "e32parser.h"
 #include "errorhandler.h"
+#include "pagedcompress.h"
 
 using std::fstream;
 
@@ -49,6 +51,18 @@ E32Parser::~E32Parser()
         delete iBufferedFile;
 }
 
+/** \brief Set number of threads for decompression
+ *
+ * Should be called before GetFileLayout(). The image does not depend on it.
+ *
+ * \param aJobs - number of threads, 0 - one per CPU core
+ *
+ */
+void E32Parser::SetJobs(uint32_t aJobs)
+{
+    iJobs = aJobs;
+}
+
 void E32Parser::ReadFile()
 {
     if(iBufferedFile)
@@ -102,8 +116,7 @@ E32ImageHeader* E32Parser::GetFileLayout()
     return iHdr;
 }
 
-void InflateUnCompress(unsigned char* source, int sourcesize,unsigned char* dest, int destsize);
-int DecompressPages(uint8_t* bytes, std::ifstream& is);
+int InflateUnCompress(unsigned char* source, int sourcesize,unsigned char* dest, int destsize);
 
 void E32Parser::DecompressImage()
 {
@@ -111,22 +124,21 @@ void E32Parser::DecompressImage()
         return;
 
     uint32_t buf_size = iHdrJ->iUncompressedSize;
+    size_t fileSize = iE32Size;
     iE32Size = Adjust(buf_size + iHdr->iCodeOffset);
 
     if(iHdr->iCompressionType == KUidCompressionDeflate)
     {
-        char *decompress = new char[buf_size]();
-        uint32_t destsize = buf_size;
-        uint32_t remainder = iE32Size - iHdr->iCodeOffset;
-        InflateUnCompress( (unsigned char*)(iBufferedFile+iHdr->iCodeOffset),
-                          remainder, (unsigned char*)(decompress), destsize);
+        // inflate the file read already straight into the new image
+        size_t offset = iHdr->iCodeOffset;
+        size_t headerSize = std::min(offset, fileSize);
 
         char *newBuf = new char[iE32Size]();
-        memcpy(newBuf, iBufferedFile, iHdr->iCodeOffset);
-        memcpy(newBuf + iHdr->iCodeOffset, decompress, buf_size);
-        memset(iBufferedFile, -1, iHdr->iCodeOffset); // will see if use old header
-        delete iBufferedFile;
-        iBufferedFile = nullptr;
+        memcpy(newBuf, iBufferedFile, headerSize);
+        uint32_t destsize = InflateUnCompress((unsigned char*)(iBufferedFile + headerSize),
+            fileSize - headerSize, (unsigned char*)(newBuf + offset), buf_size);
+
+        delete [] iBufferedFile;
         iBufferedFile = newBuf;
 
         if (destsize != buf_size)
@@ -134,28 +146,29 @@ void E32Parser::DecompressImage()
     }
     else if(iHdr->iCompressionType ==KUidCompressionBytePair)
     {
-        // that bytepair decompression doesn't support in-memory operation =(
-        // so rereading file =(
-
+        // decompress the file read already straight into the new image
         size_t offset = iHdr->iCodeOffset;
-        size_t fullsize = iHdr->iCodeOffset + iHdrJ->iUncompressedSize;
-        delete iBufferedFile;
-        iBufferedFile = nullptr;
-        iBufferedFile = new char[fullsize]();
-        std::ifstream is(iFileName, std::ifstream::in | std::ifstream::binary);
-        if(!is.is_open())
-            throw Elf2e32Error(FILEOPENERROR, iFileName);
+        size_t headerSize = std::min(offset, fileSize);
+        const uint8_t* compressed = (const uint8_t*)iBufferedFile + headerSize;
+        size_t compressedSize = fileSize - headerSize;
 
-        is.read(iBufferedFile, offset);
+        char *newBuf = new char[iE32Size]();
+        memcpy(newBuf, iBufferedFile, headerSize);
 
-        // Read and decompress code part of the image
-        unsigned int uncompressedCodeSize = DecompressPages((uint8_t *)(iBufferedFile + offset), is);
+        // Decompress code part of the image
+        size_t tableSize = 0;
+        unsigned int uncompressedCodeSize = DecompressPages((uint8_t *)(newBuf + offset),
+            iE32Size - offset, compressed, compressedSize, tableSize, iJobs);
 
-		// Read and decompress data part of the image
+		// Decompress data part of the image
 		offset+=uncompressedCodeSize;
-		unsigned int uncompressedDataSize = DecompressPages((uint8_t *)(iBufferedFile + offset), is);
+		compressed += tableSize;
+		compressedSize -= tableSize;
+		unsigned int uncompressedDataSize = DecompressPages((uint8_t *)(newBuf + offset),
+            iE32Size - offset, compressed, compressedSize, tableSize, iJobs);
 
-		is.close();
+        delete [] iBufferedFile;
+        iBufferedFile = newBuf;
 
 		if (uncompressedCodeSize + uncompressedDataSize != buf_size)
 			Message::GetInstance()->ReportMessage(WARNING, BYTEPAIRINCONSISTENTSIZEERROR);
@@ -35,6 +35,7 @@ class E32Parser
         E32Parser(const char* fileName, const char* fileBuf = nullptr);
         ~E32Parser();
 
+        void SetJobs(uint32_t aJobs);
         E32ImageHeader *GetFileLayout();
         E32ImageHeaderJ *GetE32HdrJ() const;
         E32ImageHeaderV *GetE32HdrV() const;
@@ -66,6 +67,7 @@ class E32Parser
         const char *iFileName = nullptr;
         char *iBufferedFile = nullptr;
         std::streamoff iE32Size = 0;
+        uint32_t iJobs = 1;
 
         //used in ParseExportBitMap()
         uint8_t *iExportBitMap = nullptr;
@@ -18,6 +18,7 @@
 //
 
 #include <fstream>
+#include <memory>
 
 #include "e32common.h"
 #include "e32parser.h"
@@ -25,11 +26,12 @@
 #include "errorhandler.h"
 #include "e32validator.h"
 #include "parametermanager.h"
+#include "pagedcompress.h"
+#include "pagecache.h"
 
 using std::ofstream;
 
-void DeflateCompress(char *buf, size_t size, ofstream & os);
-void CompressPages(uint8_t *buf, int32_t size, ofstream& os);
+void DeflateCompress(char *buf, size_t size, ofstream & os, int aLevel, int aJobs);
 
 E32Producer::E32Producer(ParameterManager *args) : iMan(args)
 {
@@ -57,6 +59,7 @@ void E32Producer::ReCompress()
      return;
 
     E32Parser *parser = new E32Parser(iMan->E32Input());
+    parser->SetJobs(iMan->Jobs());
     iE32Hdr = parser->GetFileLayout();
     iE32Hdr->iCompressionType = iMan->CompressionMethod();
 
@@ -85,16 +88,23 @@ void E32Producer::SaveE32(const char* s, size_t size)
         fs.write(s, offset);
 
         if(compression == KUidCompressionDeflate)
-            DeflateCompress((char*)s + offset, size - offset, fs);
+            DeflateCompress((char*)s + offset, size - offset, fs, iMan->DeflateLevel(), iMan->Jobs());
 
         else if (compression == KUidCompressionBytePair)
         {
+            std::unique_ptr<PageCache> cache;
+            if(iMan->PageCacheDir())
+                cache.reset(new PageCache(iMan->PageCacheDir(), (uint64_t)iMan->PageCacheSize() << 20));
+
             // Compress and write out code part
-            CompressPages( (uint8_t*)(s + offset), iE32Hdr->iCodeSize, fs);
+            CompressPages( (uint8_t*)(s + offset), iE32Hdr->iCodeSize, fs, iMan->Jobs(), iMan->PageStats(), cache.get());
 
             // Compress and write out data part
 			offset += iE32Hdr->iCodeSize;
-			CompressPages( (uint8_t*)(s + offset), size - offset, fs);
+			CompressPages( (uint8_t*)(s + offset), size - offset, fs, iMan->Jobs(), iMan->PageStats(), cache.get());
+
+            if(cache)
+                cache->Close(iMan->PageStats());
         }
     }
     else
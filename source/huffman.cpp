@@ -23,6 +23,8 @@
 #endif
 
 #include <cassert>
+#include <algorithm>
+#include <cstring>
 #include <portable.h>
 #include <vector>
 #include "huffman.h"
@@ -45,7 +47,7 @@ Following construction the bit stream is ready for writing bits, but will first
 OverflowL() as the output buffer is 'full'. A derived class can detect this state as
 Ptr() will return null.
 */
-TBitOutput::TBitOutput():iCode(0),iBits(-8),iPtr(nullptr),iEnd(nullptr)
+TBitOutput::TBitOutput():iCode(0),iBits(0),iPtr(nullptr),iEnd(nullptr)
 {
 }
 
@@ -59,10 +61,26 @@ for further output.
 @param "TUint8* aBuf" The buffer for output
 @param "TInt aSize" The size of the buffer in bytes
 */
-TBitOutput::TBitOutput(TUint8* aBuf,TInt aSize):iCode(0),iBits(-8),iPtr(aBuf),iEnd(aBuf+aSize)
+TBitOutput::TBitOutput(TUint8* aBuf,TInt aSize):iCode(0),iBits(0),iPtr(aBuf),iEnd(aBuf+aSize)
 {
 }
 
+/**
+Write the higher order bits to the stream
+
+The bits are collected in a 64-bit code, which is written to the buffer 32 bits at a time.
+aSize is at most 32.
+@internalComponent
+@released
+*/
+inline void TBitOutput::DoWriteL(TUint aBits,TInt aSize)
+{
+	iCode|=TUint64(aBits)<<(32-iBits);
+	iBits+=aSize;
+	if (iBits>=32)
+		FlushL(4);
+}
+
 /**
 Write a huffman code
 
@@ -104,33 +122,29 @@ next byte.
 */
 void TBitOutput::PadL(TUint aPadding)
 {
-	if (iBits>-8)
-		WriteL(aPadding?0xffffffffu:0,-iBits);
+	if (iBits&7)
+		WriteL(aPadding?0xffffffffu:0,8-(iBits&7));
+	FlushL(iBits>>3);
 }
 
 /**
-Write the higher order bits to the stream
+Write the top aBytes bytes of the code to the buffer, at most 4
 @internalComponent
 @released
 */
-void TBitOutput::DoWriteL(TUint aBits,TInt aSize)
+void TBitOutput::FlushL(TInt aBytes)
 {
-	if (aSize>25)
+	TUint64 code=iCode;
+	TUint8* p=iPtr;
+	if (iEnd-p>=aBytes)
 	{
-		// cannot process >25 bits in a single pass so do the top 8 bits first
-		assert(aSize<=32);
-		DoWriteL(aBits&0xff000000u,8);
-		aBits<<=8;
-		aSize-=8;
+		for (TInt i=0;i<aBytes;++i)
+			p[i]=TUint8(code>>(56-8*i));
+		p+=aBytes;
 	}
-
-	TInt bits=iBits;
-	TUint code=iCode|(aBits>>(bits+8));
-	bits+=aSize;
-	if (bits>=0)
+	else
 	{
-		TUint8* p=iPtr;
-		do
+		for (TInt i=0;i<aBytes;++i)
 		{
 			if (p==iEnd)
 			{
@@ -140,95 +154,114 @@ void TBitOutput::DoWriteL(TUint aBits,TInt aSize)
 				p=iPtr;
 				assert(p!=iEnd);
 			}
-			*p++=TUint8(code>>24);
-			code<<=8;
-			bits-=8;
-		} while (bits>=0);
-		iPtr=p;
-	}
-	iCode=code;
-	iBits=bits;
+			*p++=TUint8(code>>(56-8*i));
+		}
+	}
+	iPtr=p;
+	iCode=code<<(8*aBytes);
+	iBits-=8*aBytes;
 }
 
 /**
-Constructor for class TFileOutput
+Constructor for class TMemoryOutput
+The output is appended to aBuf, FlushL() trims it to the written size
 @internalComponent
 @released
 */
-TFileOutput::TFileOutput(std::ofstream & os): iDataCount(0), iOutStream(os)
+TMemoryOutput::TMemoryOutput(std::vector<TUint8>& aBuf): iBuf(aBuf)
 {
-	Set(iBuf,KBufSize);
+	size_t size=iBuf.size();
+	iBuf.resize((std::max)(size*2,size_t(KMinSize)));
+	Set(iBuf.data()+size,iBuf.size()-size);
 }
 
 /**
-Function to empty the buffer and reset the pointers
+Function to grow the buffer and continue after the data written so far
 @internalComponent
 @released
 */
-void TFileOutput::OverflowL()
+void TMemoryOutput::OverflowL()
 {
-	FlushL();
-	Set(iBuf,KBufSize);
+	size_t size=Ptr()-iBuf.data();
+	iBuf.resize(size*2);
+	Set(iBuf.data()+size,iBuf.size()-size);
 }
 
 /**
-Function to write out the contents of the buffer
+Function to trim the buffer to the data written
 @internalComponent
 @released
 */
-void TFileOutput::FlushL()
+void TMemoryOutput::FlushL()
 {
-	auto len=Ptr()-iBuf;
-	if (len)
-	{
-		iOutStream.write(reinterpret_cast<char *>(iBuf), len); // write extended header
-		iDataCount += len;
-	}
+	iBuf.resize(Ptr()-iBuf.data());
 }
 
 /**
-Recursive function to calculate the code lengths from the node tree
+A symbol with its frequency, for the Huffman code generation
 @internalComponent
 @released
 */
-void HuffmanLengthsL(TUint32* aLengths,const TNode* aNodes,TInt aNode,TInt aLen)
+struct THuffLeaf
 {
-	if (++aLen>Huffman::KMaxCodeLength)
-		throw Elf2e32Error(HUFFMANBUFFEROVERFLOWERROR);
-
-	const TNode& node=aNodes[aNode];
-	TUint x=node.iLeft;
-	if (x&KLeaf)
-		aLengths[x&~KLeaf]=aLen;
-	else
-		HuffmanLengthsL(aLengths,aNodes,x,aLen);
-	x=node.iRight;
-	if (x&KLeaf)
-		aLengths[x&~KLeaf]=aLen;
-	else
-		HuffmanLengthsL(aLengths,aNodes,x,aLen);
-}
+	TUint iCount;
+	TInt iSymbol;
+};
 
 /**
-Function to Insert the {aCount,aValue} pair into the already sorted array of nodes
+Function to calculate code lengths of at most Huffman::KMaxCodeLength with package-merge
+
+Every length up to the limit gives a list of the leaves merged with the pairs of the
+list for the next longer length, in increasing order of frequency. The first 2n-2 items of
+the last list give an optimal length limited code: every leaf gets one bit for each list it
+is taken from.
+@param aLeaves the symbols in increasing order of frequency
+@param aHuffman the table for the code lengths
 @internalComponent
 @released
 */
-void InsertInOrder(TNode* aNodes, TInt aSize, TUint aCount, TInt aVal)
+static void PackageMergeL(const std::vector<THuffLeaf>& aLeaves,TUint32 aHuffman[])
 {
-	// Uses Insertion sort following a binary search...
-	TInt left=0, right=aSize;
-	while (left < right)
+	const TInt KNoLeaf=-1;
+	struct TItem
 	{
-		TInt m = (left+right) >> 1;
-		if (aNodes[m].iCount<aCount)
-			right=m;
-		else
-			left=m+1;
+		TUint64 iCount;
+		TInt iLeaf;		// index in aLeaves, or KNoLeaf for a pair
+	};
+	const TInt n=aLeaves.size();
+	std::vector<std::vector<TItem> > lists(Huffman::KMaxCodeLength);
+	for (TInt ii=0;ii<n;++ii)
+		lists[0].push_back(TItem{aLeaves[ii].iCount,ii});
+	for (TInt len=1;len<Huffman::KMaxCodeLength;++len)
+	{
+		const std::vector<TItem>& pairs=lists[len-1];
+		std::vector<TItem>& list=lists[len];
+		TInt leaf=0;
+		for (size_t pair=0;pair+1<pairs.size();pair+=2)
+		{
+			TUint64 c=pairs[pair].iCount+pairs[pair+1].iCount;
+			for (;leaf<n && aLeaves[leaf].iCount<=c;++leaf)
+				list.push_back(TItem{aLeaves[leaf].iCount,leaf});
+			list.push_back(TItem{c,KNoLeaf});
+		}
+		for (;leaf<n;++leaf)
+			list.push_back(TItem{aLeaves[leaf].iCount,leaf});
+	}
+
+	TInt take=2*n-2;
+	for (TInt len=Huffman::KMaxCodeLength;--len>=0;)
+	{
+		TInt pairs=0;
+		for (TInt ii=0;ii<take;++ii)
+		{
+			TInt leaf=lists[len][ii].iLeaf;
+			if (leaf==KNoLeaf)
+				++pairs;
+			else
+				++aHuffman[aLeaves[leaf].iSymbol];
+		}
+		take=2*pairs;
 	}
-	memmove(aNodes+left+1,aNodes+left,sizeof(TNode)*(aSize-left));
-	aNodes[left].iCount=aCount;
-	aNodes[left].iRight=TUint16(aVal);
 }
 
 /**
@@ -242,7 +275,13 @@ Entries in the table with a frequency of zero will have a zero code length and t
 associated huffman encoding. If each such symbol should have a maximum length encoding, they
 must be given at least a frequency of 1.
 
-For an alphabet of n symbols, this algorithm has a transient memory overhead of 8n, and a
+The symbols are sorted once, then the tree is built by merging the sorted leaves with the
+nodes made so far, which come out in increasing order of frequency too. Where frequencies are
+equal the node made last is taken first, as the insertion sort used before did, so the code
+lengths are the same as before. A code longer than KMaxCodeLength is replaced by an optimal
+length limited code from PackageMergeL().
+
+For an alphabet of n symbols, this algorithm has a transient memory overhead of 20n, and a
 time complexity of O(n*log(n)).
 
 @param "const TUint32 aFrequency[]" The table of code frequencies
@@ -258,46 +297,87 @@ void Huffman::HuffmanL(const TUint32 aFrequency[],TInt aNumCodes,TUint32 aHuffma
 	if(TUint(aNumCodes)>TUint(KMaxCodes))
 		throw Elf2e32Error(HUFFMANTOOMANYCODESERROR);
 
-	// Sort the values into decreasing order of frequency
-	TNode* nodes = new TNode[aNumCodes];
-
-	TInt lCount=0;
-
+	// Sort the values into increasing order of frequency, equal ones in decreasing order of symbol
+	std::vector<THuffLeaf> leaves;
+	leaves.reserve(aNumCodes);
 	for (TInt ii=0;ii<aNumCodes;++ii)
 	{
-		TInt c=aFrequency[ii];
+		TUint c=aFrequency[ii];
 		if (c!=0)
-			InsertInOrder(nodes,lCount++,c,ii|KLeaf);
+			leaves.push_back(THuffLeaf{c,ii});
 	}
+	std::sort(leaves.begin(),leaves.end(),[](const THuffLeaf& a,const THuffLeaf& b)
+		{ return a.iCount<b.iCount || (a.iCount==b.iCount && a.iSymbol>b.iSymbol); });
 
 	// default code length is zero
 	memset(aHuffman,0,aNumCodes*sizeof(TUint32));
 
-	if (lCount==0)
+	const TInt n=leaves.size();
+	if (n==0)
 	{
 		// no codes with frequency>0. No code has a length
 	}
-	else if (lCount==1)
+	else if (n==1)
 	{
 		// special case for a single value (always encode as "0")
-		aHuffman[nodes[0].iRight&~KLeaf]=1;
+		aHuffman[leaves[0].iSymbol]=1;
 	}
 	else
 	{
-		// Huffman algorithm: pair off least frequent nodes and reorder
-		do
+		// Huffman algorithm: pair off the least frequent of the leaves and the nodes made.
+		// Node n+ii is the ii-th made, the least frequent nodes not taken yet are [head,made)
+		// unless some of them with the same frequency are being taken from the end, [runLo,runHi).
+		std::vector<TUint> counts(n-1);
+		std::vector<TInt> parent(2*n-1);
+		TInt leaf=0,head=0,runLo=0,runHi=0;
+		for (TInt made=0;made<n-1;++made)
 		{
-			--lCount;
-			TUint c=nodes[lCount].iCount + nodes[lCount-1].iCount;
-			nodes[lCount].iLeft=nodes[lCount-1].iRight;
-			// re-order the leaves now to reflect new combined frequency 'c'
-			InsertInOrder(nodes,lCount-1,c,lCount);
-		} while (lCount>1);
-		// generate code lengths in aHuffman[]
-		HuffmanLengthsL(aHuffman,nodes,1,0);
-	}
+			TUint c=0;
+			for (TInt k=0;k<2;++k)
+			{
+				TInt node;
+				TUint least=runHi>runLo ? counts[runLo] : head<made ? counts[head] : 0;
+				if ((runHi>runLo || head<made) && (leaf==n || least<=leaves[leaf].iCount))
+				{
+					if (runHi==runLo)
+					{
+						for (runLo=runHi=head;runHi<made && counts[runHi]==least;++runHi)
+							;
+						head=runHi;
+					}
+					node=n+(--runHi);
+					c+=counts[runHi];
+				}
+				else
+				{
+					node=leaf;
+					c+=leaves[leaf++].iCount;
+				}
+				parent[node]=n+made;
+			}
+			counts[made]=c;
+		}
 
-	delete [] nodes;
+		// generate code lengths in aHuffman[]. The root is made last and every parent is
+		// made after its children, so the parents can be replaced with depths going down.
+		parent[2*n-2]=0;
+		TInt maxLength=0;
+		for (TInt ii=2*n-2;--ii>=0;)
+		{
+			parent[ii]=parent[parent[ii]]+1;
+			if (ii<n)
+			{
+				aHuffman[leaves[ii].iSymbol]=parent[ii];
+				maxLength=std::max(maxLength,parent[ii]);
+			}
+		}
+
+		if (maxLength>KMaxCodeLength)
+		{
+			memset(aHuffman,0,aNumCodes*sizeof(TUint32));
+			PackageMergeL(leaves,aHuffman);
+		}
+	}
 
 	if(!IsValid(aHuffman,aNumCodes))
 		throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
@@ -611,6 +691,91 @@ void Huffman::Decoding(const TUint32 aHuffman[],TInt aNumCodes,TUint32 aDecodeTr
 		HuffmanSubTree(aDecodeTree+codes-1,aDecodeTree+codes-1,&level[0]);
 }
 
+/**
+Create the lookup tables for a canonical Huffman decoding
+
+This generates the tables used by TBitInput::HuffmanL() to read huffman encoded data a whole
+code at a time. The input is table of code lengths, as generated by Huffman::HuffmanL()
+and must represent a valid huffman code.
+
+@param "const TUint32 aHuffman[]" The table of code lengths as generated by Huffman::HuffmanL()
+@param "TInt aNumCodes" The number of codes in the table
+@param "THuffmanTable& aTable" The decoding tables
+@param "TInt aSymbolBase" the base value for the output 'symbols' from the decoding tables, by default
+this is zero.
+
+@leave "HUFFMANINVALIDCODINGERROR" If the provided code is not a valid Huffman coding
+
+@see IsValid()
+@see HuffmanL()
+*/
+void Huffman::Decoding(const TUint32 aHuffman[],TInt aNumCodes,THuffmanTable& aTable,TInt aSymbolBase)
+{
+	if(!IsValid(aHuffman,aNumCodes))
+		throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
+
+	TFixedArray<TInt,KMaxCodeLength+1> counts;
+	counts.Reset();
+	TInt codes=0;
+	TInt ii;
+	for (ii=0;ii<aNumCodes;++ii)
+	{
+		TInt len=aHuffman[ii];
+		if (len)
+		{
+			++counts[len];
+			++codes;
+		}
+	}
+
+	// canonical codes of each length follow on from the codes of the previous length
+	TFixedArray<TInt,KMaxCodeLength+1> next;
+	TUint code=0;
+	TInt index=0;
+	aTable.iLimit[0]=0;
+	for (ii=1;ii<=KMaxCodeLength;++ii)
+	{
+		code<<=1;
+		aTable.iFirst[ii]=code;
+		aTable.iIndex[ii]=next[ii]=index;
+		code+=counts[ii];
+		index+=counts[ii];
+		aTable.iLimit[ii]=code<<(KMaxCodeLength-ii);
+	}
+	aTable.iFirst[KMaxCodeLength+1]=0;
+	aTable.iIndex[KMaxCodeLength+1]=0;
+	aTable.iLimit[KMaxCodeLength+1]=0xffffffffu;	// stops the search for the length of a code
+
+	aTable.iSymbols.resize(codes);
+	for (ii=0;ii<aNumCodes;++ii)
+	{
+		TInt len=aHuffman[ii];
+		if (len)
+			aTable.iSymbols[next[len]++]=ii+aSymbolBase;
+	}
+
+	if (codes==1)	// codes==1 special case: code isn't complete
+	{
+		aTable.iSymbols.push_back(aTable.iSymbols[0]);	// 0- and 1-terminate
+		aTable.iLimit[1]=1u<<KMaxCodeLength;
+	}
+
+	// every code short enough for the lookup fills all the entries it prefixes
+	memset(aTable.iLookup,0,sizeof(aTable.iLookup));
+	for (TInt len=1;len<=THuffmanTable::KLookupBits;++len)
+	{
+		TInt fill=1<<(THuffmanTable::KLookupBits-len);
+		TInt last=(aTable.iLimit[len]>>(KMaxCodeLength-len))-aTable.iFirst[len];
+		for (TInt jj=0;jj<last;++jj)
+		{
+			TUint32 entry=(aTable.iSymbols[aTable.iIndex[len]+jj]<<8)|len;
+			TUint32* p=aTable.iLookup+((aTable.iFirst[len]+jj)<<(THuffmanTable::KLookupBits-len));
+			for (TInt kk=0;kk<fill;++kk)
+				p[kk]=entry;
+		}
+	}
+}
+
 /**
 The decoding tree for the externalised code
 */
@@ -688,7 +853,7 @@ void Huffman::InternalizeL(TBitInput& aInput,TUint32 aHuffman[],TInt aNumCodes)
 		{
 			while (rl>0)
 			{
-				if (p>end)
+				if (p>=end)
 				{
 					throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
 				}
@@ -700,7 +865,7 @@ void Huffman::InternalizeL(TBitInput& aInput,TUint32 aHuffman[],TInt aNumCodes)
 			last=list[c];
 
 			memmove((void * const)&list[1],(const void * const)&list[0],(size_t)c);
-			if (p>end)
+			if (p>=end)
 			{
 				throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
 			}
@@ -709,7 +874,7 @@ void Huffman::InternalizeL(TBitInput& aInput,TUint32 aHuffman[],TInt aNumCodes)
 	}
 	while (rl>0)
 	{
-		if (p>end)
+		if (p>=end)
 		{
 			throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
 		}
@@ -718,20 +883,6 @@ void Huffman::InternalizeL(TBitInput& aInput,TUint32 aHuffman[],TInt aNumCodes)
 	}
 }
 
-/**
-bit-stream input class
-Reverse the byte-order of a 32 bit value
-This generates optimal ARM code (4 instructions)
-*/
-inline TUint reverse(TUint aVal)
-{
-	TUint v=(aVal<<16)|(aVal>>16);
-	v^=aVal;
-	v&=0xff00ffff;
-	aVal=(aVal>>8)|(aVal<<24);
-	return aVal^(v>>8);
-}
-
 /**
 Construct a bit stream input object
 
@@ -767,26 +918,50 @@ Bits will be read from this buffer until it is empty, at which point UnderflowL(
 @param "TInt aOffset" The bit offset from the start of the buffer to the bit stream (defaults to zero)
 */
 void TBitInput::Set(const TUint8* aPtr, TInt aLength, TInt aOffset)
-{
-	size_t p=(size_t)aPtr;
-	p+=aOffset>>3;			// nearest byte to the specified bit offset
-	aOffset&=7;				// bit offset within the byte
-	const TUint32* ptr=(const TUint32*)(p&~3);	// word containing this byte
-	aOffset+=(p&3)<<3;		// bit offset within the word
-	if (aLength==0)
+{
+	iPtr=aPtr+(aOffset>>3);		// nearest byte to the specified bit offset
+	aOffset&=7;					// bit offset within the byte
+	iBits=0;
+	iCount=0;
+	iRemain=aLength ? aLength+aOffset : 0;
+	Refill();
+	// drop the bits before the stream
+	iBits<<=aOffset;
+	iCount-=aOffset;
+	if (iCount<0)
 		iCount=0;
-	else
+}
+
+/**
+Top up the bit buffer from memory
+
+Loads whole bytes until at least 57 bits are held or the buffer is empty. Away from the end of
+the buffer eight bytes are loaded at once, near the end it goes a byte at a time so that
+nothing past the end of the bit stream is read.
+*/
+void TBitInput::Refill()
+{
+	if (iRemain>=64)
+	{
+		const TUint8* p=iPtr;
+		TUint64 word=(TUint64(p[0])<<56)|(TUint64(p[1])<<48)|(TUint64(p[2])<<40)|(TUint64(p[3])<<32)|
+			(TUint64(p[4])<<24)|(TUint64(p[5])<<16)|(TUint64(p[6])<<8)|TUint64(p[7]);
+		iBits|=word>>iCount;
+		TInt bytes=(63-iCount)>>3;
+		iPtr+=bytes;
+		iCount+=bytes<<3;
+		iRemain-=bytes<<3;
+		return;
+	}
+	while (iCount<=56 && iRemain>0)
 	{
-		// read the first few bits of the stream
-		iBits=reverse(*ptr++)<<aOffset;
-		aOffset=32-aOffset;
-		aLength-=aOffset;
-		if (aLength<0)
-			aOffset+=aLength;
-		iCount=aOffset;
+		TUint byte=*iPtr++;
+		TInt bits=iRemain<8 ? iRemain : 8;
+		byte&=0xff00u>>bits;		// scrub the bits past the end of the stream
+		iBits|=TUint64(byte)<<(56-iCount);
+		iCount+=bits;
+		iRemain-=bits;
 	}
-	iRemain=aLength;
-	iPtr=ptr;
 }
 
 #ifndef __HUFFMAN_MACHINE_CODED__
@@ -804,13 +979,16 @@ data
 */
 TUint TBitInput::ReadL()
 {
-	TInt c=iCount;
-	TUint bits=iBits;
-	if (--c<0)
-		return ReadL(1);
-	iCount=c;
-	iBits=bits<<1;
-	return bits>>31;
+	if (iCount==0)
+	{
+		Refill();
+		if (iCount==0)
+			return ReadL(1);
+	}
+	TUint bit=TUint(iBits>>63);
+	iBits<<=1;
+	--iCount;
+	return bit;
 }
 
 /**
@@ -834,44 +1012,26 @@ TUint TBitInput::ReadL(TInt aSize)
 {
 	if (!aSize)
 		return 0;
-	TUint val=0;
-	TUint bits=iBits;
-	iCount-=aSize;
-	while (iCount<0)
-	{
-		// need more bits
-#ifdef __CPU_X86
-		// X86 does not allow shift-by-32
-		if (iCount+aSize!=0)
-			val|=bits>>(32-(iCount+aSize))<<(-iCount);	// scrub low order bits
-#else
-		val|=bits>>(32-(iCount+aSize))<<(-iCount);	// scrub low order bits
-#endif
-		aSize=-iCount;	// bits still required
-		if (iRemain>0)
-		{
-			bits=reverse(*iPtr++);
-			iCount+=32;
-			iRemain-=32;
-			if (iRemain<0)
-				iCount+=iRemain;
-		}
-		else
+	if (iCount<aSize)
+	{
+		Refill();
+		if (iCount<aSize)
 		{
+			// take what is left, UnderflowL() has to provide the rest
+			TInt have=iCount;
+			TUint val=have ? TUint(iBits>>(64-have)) : 0;
+			iBits=0;
+			iCount=0;
 			UnderflowL();
-			bits=iBits;
-			iCount-=aSize;
+			aSize-=have;
+			TUint rest=ReadL(aSize);
+			return have ? (val<<aSize)|rest : rest;
 		}
 	}
-
-#ifdef __CPU_X86
-	// X86 does not allow shift-by-32
-	iBits=aSize==32?0:bits<<aSize;
-#else
-	iBits=bits<<aSize;
-#endif
-
-	return val|(bits>>(32-aSize));
+	TUint val=TUint(iBits>>(64-aSize));
+	iBits<<=aSize;
+	iCount-=aSize;
+	return val;
 }
 
 /**
@@ -903,6 +1063,62 @@ TUint TBitInput::HuffmanL(const TUint32* aTree)
 
 #endif
 
+/**
+Read and decode a Huffman Code through lookup tables
+
+Interpret the next bits in the input as a Huffman code in the specified decoding.
+The tables should be the output from Huffman::Decoding(). While a whole code is held in the
+bit buffer it is decoded without reading bit by bit, near the end of the input the code is
+read a bit at a time so that UnderflowL() is called as for the decoding tree.
+
+@param "const THuffmanTable& aTable" The huffman decoding tables
+
+@return The symbol that was decoded
+
+@leave "UnderflowL()" It the bit stream is exhausted more UnderflowL is called to get more
+data
+*/
+TUint TBitInput::HuffmanL(const THuffmanTable& aTable)
+{
+	const TInt KMaxCodeLength=Huffman::KMaxCodeLength;
+	if (iCount<KMaxCodeLength)
+		Refill();
+
+	TInt len;
+	TUint code;
+	if (iCount>=KMaxCodeLength)
+	{
+		TUint entry=aTable.iLookup[iBits>>(64-THuffmanTable::KLookupBits)];
+		if (entry)
+		{
+			iBits<<=entry&0xff;
+			iCount-=entry&0xff;
+			return entry>>8;
+		}
+		code=TUint(iBits>>(64-KMaxCodeLength));
+		for (len=THuffmanTable::KLookupBits+1;code>=aTable.iLimit[len];++len)
+			;
+		if (len>KMaxCodeLength)
+			throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
+		iBits<<=len;
+		iCount-=len;
+		code>>=KMaxCodeLength-len;
+	}
+	else
+	{
+		code=0;
+		for (len=1;;++len)
+		{
+			if (len>KMaxCodeLength)
+				throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
+			code=(code<<1)|ReadL();
+			if ((code<<(KMaxCodeLength-len))<aTable.iLimit[len])
+				break;
+		}
+	}
+	return aTable.iSymbols[aTable.iIndex[len]+code-aTable.iFirst[len]];
+}
+
 /**
 Handle an empty input buffer
 
@@ -22,7 +22,7 @@
 #define __HUFFMAN_H__
 
 #include <portable.h>
-#include <fstream>
+#include <vector>
 
 /** Bit output stream.
 	Good for writing bit streams for packed, compressed or huffman data algorithms.
@@ -43,11 +43,12 @@ class TBitOutput
 		void PadL(TUint aPadding);
 		virtual ~TBitOutput() = default;
 	private:
-		void DoWriteL(TUint aBits, TInt aSize);
+		inline void DoWriteL(TUint aBits, TInt aSize);
+		void FlushL(TInt aBytes);
 		virtual void OverflowL();
 	private:
-		TUint iCode;		// code in production
-		TInt iBits;
+		TUint64 iCode;		// code in production, from the top bit down
+		TInt iBits;			// number of bits in iCode
 		TUint8* iPtr;
 		TUint8* iEnd;
 };
@@ -80,35 +81,34 @@ inline const TUint8* TBitOutput::Ptr() const
 /**
 Get the number of bits that are buffered
 
-This reports the number of bits that have not yet been written into the output buffer.It will
-always lie in the range 0..7. Use PadL() to pad the data out to the next byte and write it to
+This reports the number of bits that have not yet been written into the output buffer. It will
+always lie in the range 0..31. Use PadL() to pad the data out to the next byte and write it to
 the buffer.
 */
 inline TInt TBitOutput::BufferedBits() const
 {
-	return iBits+8;
+	return iBits;
 }
 
 /**
-This class is derived from TBitOutput
+This class is derived from TBitOutput and writes to a growable buffer owned by the caller
 @internalComponent
 @released
 */
-class TFileOutput : public TBitOutput
+class TMemoryOutput : public TBitOutput
 {
-	enum {KBufSize=0x1000};
+	enum {KMinSize=0x1000};
 	public:
-		explicit TFileOutput(std::ofstream & os);
+		explicit TMemoryOutput(std::vector<TUint8>& aBuf);
 		void FlushL();
-		TUint32 iDataCount = 0;
-		virtual ~TFileOutput() = default;
 	private:
 		void OverflowL();
 	private:
-		std::ofstream & iOutStream;
-		TUint8 iBuf[KBufSize];
+		std::vector<TUint8>& iBuf;
 };
 
+class THuffmanTable;
+
 /**
 Class for Bit input stream.
 Good for reading bit streams for packed, compressed or huffman data algorithms.
@@ -126,14 +126,16 @@ public:
     TUint ReadL();
     TUint ReadL(TInt aSize);
     TUint HuffmanL(const TUint32* aTree);
+    TUint HuffmanL(const THuffmanTable& aTable);
     virtual ~TBitInput();
 private:
+    void Refill();
     virtual void UnderflowL();
 private:
-    TInt iCount;
-    TUint iBits;
-    TInt iRemain;
-    const TUint32* iPtr;
+    TInt iCount;		// bits held in iBits
+    TUint64 iBits;		// next bits of the stream, left-aligned
+    TInt iRemain;		// bits left in the buffer after iBits
+    const TUint8* iPtr;
 };
 
 /**
@@ -183,18 +185,29 @@ class Huffman
 		static bool IsValid(const TUint32 aHuffman[],TInt aNumCodes);
 		static void ExternalizeL(TBitOutput& aOutput,const TUint32 aHuffman[],TInt aNumCodes);
 		static void Decoding(const TUint32 aHuffman[],TInt aNumCodes,TUint32 aDecodeTree[],TInt aSymbolBase=0);
+		static void Decoding(const TUint32 aHuffman[],TInt aNumCodes,THuffmanTable& aTable,TInt aSymbolBase=0);
 		static void InternalizeL(TBitInput& aInput,TUint32 aHuffman[],TInt aNumCodes);
 };
 
-// local definitions used for Huffman code generation
-typedef TUint16 THuff;		/** @internal */
-const THuff KLeaf=0x8000;	/** @internal */
-struct TNode
-/** @internal */
+/**
+Lookup tables for decoding a canonical huffman code with TBitInput::HuffmanL().
+
+Codes of up to KLookupBits are decoded with a single probe of iLookup. Longer codes are
+found by comparing the next KMaxCodeLength bits against the limit of each code length.
+The tables are built by Huffman::Decoding().
+@internalComponent
+@released
+*/
+class THuffmanTable
 {
-	TUint iCount;
-	THuff iLeft;
-	THuff iRight;
+	public:
+		enum {KLookupBits=10};
+	public:
+		TUint32 iLookup[1<<KLookupBits];				// (symbol<<8)|length, zero for longer codes
+		TUint32 iFirst[Huffman::KMaxCodeLength+2];		// first code of each length
+		TUint32 iLimit[Huffman::KMaxCodeLength+2];		// end of the codes of each length, left-aligned
+		TUint32 iIndex[Huffman::KMaxCodeLength+2];		// iSymbols index of the first code of each length
+		std::vector<TUint32> iSymbols;					// symbols in code order
 };
 
 const TInt KDeflateLengthMag=8;
@@ -221,11 +234,15 @@ class TEncoding
 
 // hashing
 const TUint KDeflateHashMultiplier=0xAC4B9B19u;
-const TInt KDeflateHashShift=24;
+const TInt KDeflateHashBits=16;
+const TInt KDeflateHashShift=32-KDeflateHashBits;
+const TInt KDeflateHashSize=1<<KDeflateHashBits;
 
 const TInt KDeflationCodes=TEncoding::ELitLens+TEncoding::EDistances;
 const TInt KDeflateMinLength=3;
 const TInt KDeflateMaxLength=KDeflateMinLength-1 + (1<<KDeflateLengthMag);
+const TInt KDeflateMaxLevel=9;
+const TInt KDeflateOptimalLevel=KDeflateMaxLevel+1;
 
 #endif
 
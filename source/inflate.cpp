@@ -128,9 +128,9 @@ void CInflater::InitL()
 		throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
 	}
 
-	// convert the length tables into huffman decoding trees
-	Huffman::Decoding(iEncoding->iLitLen,TEncoding::ELitLens,iEncoding->iLitLen);
-	Huffman::Decoding(iEncoding->iDistance,TEncoding::EDistances,iEncoding->iDistance,KDeflateDistCodeBase);
+	// convert the length tables into huffman decoding tables
+	Huffman::Decoding(iEncoding->iLitLen,TEncoding::ELitLens,iLitLenTable);
+	Huffman::Decoding(iEncoding->iDistance,TEncoding::EDistances,iDistanceTable,KDeflateDistCodeBase);
 }
 
 /*
@@ -145,7 +145,7 @@ TInt CInflater::InflateL()
 	// empty the history buffer into the output
 	TUint8* out=iOut;
 	TUint8* const end=out+KDeflateMaxDistance;
-	const TUint32* tree=iEncoding->iLitLen;
+	const THuffmanTable* table=&iLitLenTable;
 	if (iLen<0)	// EOF
 		return 0;
 	if (iLen>0)
@@ -155,7 +155,7 @@ TInt CInflater::InflateL()
 	{
 		// get a huffman code
 		{
-			TInt val=iBits->HuffmanL(tree)-TEncoding::ELiterals;
+			TInt val=iBits->HuffmanL(*table)-TEncoding::ELiterals;
 			if (val<0)
 			{
 				*out++=TUint8(val);
@@ -179,7 +179,7 @@ TInt CInflater::InflateL()
 			if (val<KDeflateDistCodeBase-TEncoding::ELiterals)
 			{	// length code... get the code
 				iLen=code+KDeflateMinLength;
-				tree=iEncoding->iDistance;
+				table=&iDistanceTable;
 				continue;			// read the huffman code
 			}
 			// distance code
@@ -203,12 +203,95 @@ TInt CInflater::InflateL()
 					from-=KDeflateMaxDistance;
 			}while (--tfr!=0);
 			iRptr=from;
-			tree=iEncoding->iLitLen;
+			table=&iLitLenTable;
 	};
 
 	return out-iOut;
 }
 
+/*
+Decode the whole stream straight into the destination buffer
+
+The destination is the history for distance matches, so nothing goes through the circular
+buffer and a match of eight bytes or more apart is copied a word at a time. This must be
+the only read from the inflater.
+@param aBuffer the destination
+@param aLength the size of the destination, decoding stops when it is full
+@return the number of bytes decoded
+@internalComponent
+@released
+*/
+TInt CInflater::DecompressL(TUint8* aBuffer,TInt aLength)
+{
+	TUint8* out=aBuffer;
+	TUint8* const end=out+aLength;
+	const THuffmanTable* table=&iLitLenTable;
+	TInt len=0;
+
+	while (out<end)
+	{
+		TInt val=iBits->HuffmanL(*table)-TEncoding::ELiterals;
+		if (val<0)
+		{
+			*out++=TUint8(val);
+			continue;			// another literal/length combo
+		}
+		if (val==TEncoding::EEos-TEncoding::ELiterals)
+			break;				// eos marker. we're done
+
+		// get the extra bits for the code
+		TInt code=val&0xff;
+		if (code>=8)
+		{	// xtra bits
+			TInt xtra=(code>>2)-1;
+			code-=xtra<<2;
+			code<<=xtra;
+			code|=iBits->ReadL(xtra);
+		}
+		if (val<KDeflateDistCodeBase-TEncoding::ELiterals)
+		{	// length code... get the code
+			len=code+KDeflateMinLength;
+			table=&iDistanceTable;
+			continue;			// read the huffman code
+		}
+		table=&iLitLenTable;
+
+		// distance code
+		TInt dist=code+1;
+		if (dist>out-aBuffer)
+			throw Elf2e32Error(HUFFMANINVALIDCODINGERROR);
+		if (len>end-out)
+			len=end-out;
+		const TUint8* from=out-dist;
+		if (dist==1)
+		{
+			memset(out,*from,len);
+			out+=len;
+		}
+		else if (dist>=8 && end-out>=len+7)
+		{	// whole words, the last one may spill over bytes decoded later
+			TUint8* const stop=out+len;
+			do
+			{
+				memcpy(out,from,8);
+				out+=8;
+				from+=8;
+			} while (out<stop);
+			out=stop;
+		}
+		else
+		{
+			do
+			{
+				*out++=*from++;
+			} while (--len!=0);
+		}
+	}
+
+	iLen=-1;
+	return out-aBuffer;
+}
+
 /*
 TFileInput Constructor
 @param source
@@ -248,15 +331,17 @@ Function InflateUncompress
 @param sourcesize
 @param dest
 @param destsize
+@return the number of bytes decoded
 @internalComponent
 @released
 */
-void InflateUnCompress(unsigned char* source, int sourcesize,unsigned char* dest, int destsize)
+int InflateUnCompress(unsigned char* source, int sourcesize,unsigned char* dest, int destsize)
 {
 	TFileInput* input = new TFileInput(source, sourcesize);
 	CInflater* inflater=CInflater::NewLC(*input);
-	inflater->ReadL(dest,destsize);
+	int size=inflater->DecompressL(dest,destsize);
 	delete input;
 	delete inflater;
+	return size;
 }
 
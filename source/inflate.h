@@ -39,6 +39,7 @@ class CInflater
 		~CInflater();
 		TInt ReadL(TUint8* aBuffer,TInt aLength);
 		TInt SkipL(TInt aLength);
+		TInt DecompressL(TUint8* aBuffer,TInt aLength);
 	private:
 		CInflater(TBitInput& aInput);
 		void ConstructL();
@@ -51,6 +52,8 @@ class CInflater
 		const TUint8* iAvail;			// available data
 		const TUint8* iLimit;
 		TEncoding* iEncoding;
+		THuffmanTable iLitLenTable;
+		THuffmanTable iDistanceTable;
 		TUint8* iOut;					// circular buffer for distance matches
 		TUint8 iHuff[EBufSize+ESafetyZone];	// huffman data
 };
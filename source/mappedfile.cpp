@@ -0,0 +1,87 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Copy-on-write mapping of input files
+// @internalComponent
+// @released
+//
+//
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "mappedfile.h"
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& aName)
+{
+    Close();
+#ifdef __LINUX__
+    int fd = open(aName.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if(data == MAP_FAILED)
+        return false;
+    iData = (char*)data;
+    iSize = (size_t)st.st_size;
+#else
+    HANDLE file = CreateFileA(aName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if(GetFileSizeEx(file, &size) && size.QuadPart > 0 && (size_t)size.QuadPart == size.QuadPart)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(!mapping)
+        return false;
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);   // the view keeps the mapping alive
+    if(!data)
+        return false;
+    iData = (char*)data;
+    iSize = (size_t)size.QuadPart;
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if(!iData)
+        return;
+#ifdef __LINUX__
+    munmap(iData, iSize);
+#else
+    UnmapViewOfFile(iData);
+#endif
+    iData = nullptr;
+    iSize = 0;
+}
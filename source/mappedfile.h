@@ -0,0 +1,55 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Copy-on-write mapping of input files
+// @internalComponent
+// @released
+//
+//
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+Maps a whole file into memory as a private copy-on-write view.
+
+Pages are read from the file when first touched and copied only when written,
+writes never reach the file.
+*/
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+    Maps aName, replacing any previous mapping.
+    @return false if the file can't be opened, is empty or mapping isn't supported
+    */
+    bool Open(const std::string& aName);
+    void Close();
+
+    char* Data() const { return iData; }
+    size_t Size() const { return iSize; }
+
+private:
+    char* iData = nullptr;
+    size_t iSize = 0;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,105 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Length of the common prefix of two byte strings for the deflate match finders
+// @internalComponent
+// @released
+//
+//
+
+#ifndef MATCHLENGTH_H
+#define MATCHLENGTH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cpufeatures.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATCHLENGTH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MATCHLENGTH_BIG_ENDIAN 1
+#endif
+
+/*
+All variants return the number of equal bytes at aPtr and aMatch, counting
+no further than aEnd. They read nothing at or after aEnd, aMatch must be below
+aPtr so that it stays in the buffer too.
+*/
+
+/** One byte at a time, the reference for the other variants. */
+inline int MatchLengthBytes(const uint8_t* aPtr, const uint8_t* aMatch, const uint8_t* aEnd)
+{
+    const uint8_t* p = aPtr;
+    while(p < aEnd && *p == *aMatch)
+    {
+        p++;
+        aMatch++;
+    }
+    return (int)(p - aPtr);
+}
+
+/** Eight bytes at a time, the first differing byte is the lowest set byte of their XOR. */
+inline int MatchLengthWords(const uint8_t* aPtr, const uint8_t* aMatch, const uint8_t* aEnd)
+{
+#ifdef MATCHLENGTH_BIG_ENDIAN
+    return MatchLengthBytes(aPtr, aMatch, aEnd);
+#else
+    const uint8_t* p = aPtr;
+    while(aEnd - p >= 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, p, 8);
+        memcpy(&y, aMatch, 8);
+        if(x != y)
+            return (int)(p - aPtr) + (LowestBit(x ^ y) >> 3);
+        p += 8;
+        aMatch += 8;
+    }
+    return (int)(p - aPtr) + MatchLengthBytes(p, aMatch, aEnd);
+#endif
+}
+
+#ifdef MATCHLENGTH_SSE2
+/** Sixteen bytes at a time with pcmpeqb and pmovmskb. */
+inline int MatchLengthSse2(const uint8_t* aPtr, const uint8_t* aMatch, const uint8_t* aEnd)
+{
+    const uint8_t* p = aPtr;
+    while(aEnd - p >= 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)aMatch);
+        unsigned differ = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xffff;
+        if(differ)
+            return (int)(p - aPtr) + LowestBit(differ);
+        p += 16;
+        aMatch += 16;
+    }
+    return (int)(p - aPtr) + MatchLengthWords(p, aMatch, aEnd);
+}
+#endif
+
+/** The fastest variant the build targets. */
+inline int MatchLength(const uint8_t* aPtr, const uint8_t* aMatch, const uint8_t* aEnd)
+{
+#ifdef MATCHLENGTH_SSE2
+    return MatchLengthSse2(aPtr, aMatch, aEnd);
+#else
+    return MatchLengthWords(aPtr, aMatch, aEnd);
+#endif
+}
+
+#endif // MATCHLENGTH_H
@@ -0,0 +1,268 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// On-disk cache of byte-pair compressed pages for the elf2e32 tool
+// @internalComponent
+// @released
+//
+//
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __LINUX__
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#else
+#include <io.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#endif
+
+#include "byte_pair.h"
+#include "pagecache.h"
+#include "message.h"
+
+// Changes with the format of the entries. The version of the compressed
+// pages, KBytePairVersion, is in the name and the header of every entry.
+static const char KPageCacheMagic[4] = {'E', 'P', 'C', '2'};
+static const uint64_t KPageCacheMethod = 0x6279746570616972ull; // "bytepair"
+
+// Largest page and largest compressed page
+static const int32_t KMaxPage = 0x1000;
+static const int32_t KMaxOut = 4 * KMaxPage;
+
+struct EntryHeader
+{
+    char iMagic[4];
+    uint32_t iVersion;
+    uint16_t iSize;
+    uint16_t iOutSize;
+    uint32_t iReserved;
+    uint64_t iCheck;
+};
+
+static uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+static uint64_t Hash(const uint8_t* aData, size_t aSize, uint64_t aSeed)
+{
+    uint64_t h = Mix(aSeed ^ aSize);
+    size_t i = 0;
+    for(; i + 8 <= aSize; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, aData + i, sizeof(w));
+        h = Mix(h ^ w) + 0x9e3779b97f4a7c15ull;
+    }
+    for(; i < aSize; i++)
+        h = Mix(h ^ aData[i]);
+    return h;
+}
+
+static void MakeDir(const std::string& aDir)
+{
+#ifdef __LINUX__
+    mkdir(aDir.c_str(), 0777);
+#else
+    _mkdir(aDir.c_str());
+#endif
+}
+
+struct CacheFile
+{
+    std::string iName;
+    uint64_t iSize;
+    time_t iTime;
+};
+
+static void ListDir(const std::string& aDir, std::vector<CacheFile>& aFiles, bool aDirs)
+{
+#ifdef __LINUX__
+    DIR* dir = opendir(aDir.c_str());
+    if(!dir)
+        return;
+    while(dirent* e = readdir(dir))
+    {
+        if(e->d_name[0] == '.')
+            continue;
+        std::string name = aDir + "/" + e->d_name;
+        struct stat st;
+        if(stat(name.c_str(), &st) != 0 || S_ISDIR(st.st_mode) != aDirs)
+            continue;
+        aFiles.push_back({name, (uint64_t)st.st_size, st.st_mtime});
+    }
+    closedir(dir);
+#else
+    _finddata_t e;
+    intptr_t h = _findfirst((aDir + "/*").c_str(), &e);
+    if(h == -1)
+        return;
+    do
+    {
+        if(e.name[0] == '.' || ((e.attrib & _A_SUBDIR) != 0) != aDirs)
+            continue;
+        aFiles.push_back({aDir + "/" + e.name, (uint64_t)e.size, e.time_write});
+    }
+    while(_findnext(h, &e) == 0);
+    _findclose(h);
+#endif
+}
+
+/**
+@param aDir - cache directory, created if it doesn't exist
+@param aMaxSize - size limit of the cache in bytes
+*/
+PageCache::PageCache(const char* aDir, uint64_t aMaxSize):
+    iDir(aDir), iMaxSize(aMaxSize)
+{
+    MakeDir(iDir);
+}
+
+std::string PageCache::EntryName(const uint8_t* aPage, int32_t aSize) const
+{
+    char name[20];
+    uint64_t hash = Hash(aPage, aSize, KPageCacheMethod + KBytePairVersion);
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return iDir + "/" + std::string(name, 2) + "/" + (name + 2);
+}
+
+/**
+Find the compressed form of a page.
+@param aPage - page to compress
+@param aSize - size of the page
+@param aOut - destination of the compressed page, at least 4 times aSize
+@param aOutSize - returns size of the compressed page
+@return true if the page was found
+*/
+bool PageCache::Lookup(const uint8_t* aPage, int32_t aSize, uint8_t* aOut, int32_t& aOutSize)
+{
+    std::string name = EntryName(aPage, aSize);
+    bool found = false;
+    if(FILE* f = fopen(name.c_str(), "rb"))
+    {
+        uint8_t page[KMaxPage];
+        EntryHeader h;
+        found = fread(&h, sizeof(h), 1, f) == 1 && !memcmp(h.iMagic, KPageCacheMagic, sizeof(h.iMagic)) &&
+            h.iVersion == KBytePairVersion && h.iSize == aSize && h.iOutSize <= KMaxOut && h.iOutSize <= 4 * aSize &&
+            fread(page, 1, aSize, f) == (size_t)aSize && !memcmp(page, aPage, aSize) &&
+            fread(aOut, 1, h.iOutSize, f) == h.iOutSize &&
+            Hash(aOut, h.iOutSize, Hash(aPage, aSize, 0)) == h.iCheck;
+        fclose(f);
+        if(found)
+        {
+            aOutSize = h.iOutSize;
+            // the time of last use for Trim()
+            utime(name.c_str(), nullptr);
+        }
+    }
+    ++(found ? iHits : iMisses);
+    return found;
+}
+
+/**
+Add a compressed page. Failures are ignored, the page is just not cached.
+@param aPage - the page
+@param aSize - size of the page
+@param aOut - the compressed page
+@param aOutSize - size of the compressed page
+*/
+void PageCache::Store(const uint8_t* aPage, int32_t aSize, const uint8_t* aOut, int32_t aOutSize)
+{
+    if(aSize > KMaxPage || aOutSize > KMaxOut)
+        return;
+    EntryHeader h;
+    memcpy(h.iMagic, KPageCacheMagic, sizeof(h.iMagic));
+    h.iVersion = KBytePairVersion;
+    h.iReserved = 0;
+    h.iSize = (uint16_t)aSize;
+    h.iOutSize = (uint16_t)aOutSize;
+    h.iCheck = Hash(aOut, aOutSize, Hash(aPage, aSize, 0));
+
+    std::string name = EntryName(aPage, aSize);
+    MakeDir(name.substr(0, iDir.size() + 3));
+
+    // write aside and rename, so readers never see a part of an entry
+    std::ostringstream temp;
+    temp << name << '.' << getpid() << '.' << iTemp++ << ".tmp";
+    FILE* f = fopen(temp.str().c_str(), "wb");
+    if(!f)
+        return;
+    bool written = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(aPage, 1, aSize, f) == (size_t)aSize &&
+        fwrite(aOut, 1, aOutSize, f) == (size_t)aOutSize;
+    written = !fclose(f) && written;
+    if(written && !rename(temp.str().c_str(), name.c_str()))
+        ++iStores;
+    else
+        remove(temp.str().c_str());
+}
+
+/**
+Remove the least recently used entries while the cache is larger than its limit.
+*/
+void PageCache::Trim()
+{
+    std::vector<CacheFile> dirs;
+    std::vector<CacheFile> files;
+    ListDir(iDir, dirs, true);
+    for(const CacheFile& d: dirs)
+        ListDir(d.iName, files, false);
+
+    uint64_t total = 0;
+    for(const CacheFile& f: files)
+        total += f.iSize;
+    if(total <= iMaxSize)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b)
+        { return a.iTime < b.iTime; });
+    for(const CacheFile& f: files)
+    {
+        if(total <= iMaxSize)
+            break;
+        if(!remove(f.iName.c_str()))
+        {
+            total -= f.iSize;
+            ++iEvicted;
+        }
+    }
+}
+
+/**
+Finish using the cache, trim it if pages were added.
+@param aReport - print hit and miss counts
+*/
+void PageCache::Close(bool aReport)
+{
+    if(iStores)
+        Trim();
+    if(!aReport)
+        return;
+    std::ostringstream report;
+    report << "Page cache: " << iHits << " hits, " << iMisses << " misses, "
+        << iStores << " stored, " << iEvicted << " evicted";
+    Message::GetInstance()->Output(report.str());
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// On-disk cache of byte-pair compressed pages for the elf2e32 tool
+// @internalComponent
+// @released
+//
+//
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+/**
+Cache of compressed pages shared by rebuilds, enabled with --pagecache.
+
+Every entry is a file named by the hash of the page and the version of the
+compressor, it holds the page itself and its compressed form. A lookup
+compares the page and the version, so a hash collision, an entry of another
+compressor version or a damaged entry is a miss and the output is always the
+one of the compressor.
+Entries are never changed, concurrent builds may share the directory.
+
+Close() removes the least recently used entries while the cache is larger
+than its limit. Lookup() and Store() may be called from several threads.
+@internalComponent
+@released
+*/
+class PageCache
+{
+    public:
+        PageCache(const char* aDir, uint64_t aMaxSize);
+
+        bool Lookup(const uint8_t* aPage, int32_t aSize, uint8_t* aOut, int32_t& aOutSize);
+        void Store(const uint8_t* aPage, int32_t aSize, const uint8_t* aOut, int32_t aOutSize);
+        void Close(bool aReport);
+
+    private:
+        std::string EntryName(const uint8_t* aPage, int32_t aSize) const;
+        void Trim();
+
+    private:
+        std::string iDir;
+        uint64_t iMaxSize;
+        std::atomic<uint32_t> iHits{0};
+        std::atomic<uint32_t> iMisses{0};
+        std::atomic<uint32_t> iStores{0};
+        std::atomic<uint32_t> iTemp{0};
+        uint32_t iEvicted = 0;
+};
+
+#endif // PAGECACHE_H
@@ -21,8 +21,17 @@
 
 #include <fstream>
 #include <sstream>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
 
 #include "byte_pair.h"
+#include "pagedcompress.h"
+#include "parallel.h"
+#include "pagecache.h"
+#include "message.h"
 
 #define PAGE_SIZE 4096
 
@@ -31,9 +40,9 @@
 
 struct IndexTableItem
 {
-	TUint16 iSizeOfCompressedPageData;	// pointer to an array TUint16[NumberOfPages]
-	TUint8 *iCompressedPageData;		// pointer to an array TUint8*. Each elemet of
-										// this array point a compressed Page data
+	TUint16 iSizeOfCompressedPageData;
+	TUint16 iArena;						// arena of the worker which compressed the page
+	TUint32 iOffset;					// offset of the compressed page in its arena
 };
 
 
@@ -45,33 +54,49 @@ struct IndexTableHeader
 };
 
 
+// Page classes found by CBytePairCompressedImage::AddPage(). Pages of few byte
+// values are no class of their own, the tokens of Pak() need its pair search.
+enum TPageClass
+{
+	EPageConstant,			// one byte value, encoded without pair search
+	EPageIncompressible,	// high entropy, stored without pair search
+	EPageOther,				// compressed by Pak()
+	EPageClasses
+};
+
+// Pages with at least this entropy in bits per byte are checked for being incompressible
+const double KHighEntropy = 7.0;
+
+
 class CBytePairCompressedImage
 {
 	public:
-		static CBytePairCompressedImage* NewLC(TUint16 aNumberOfPages, TInt aSize);
+		static CBytePairCompressedImage* NewLC(TUint16 aNumberOfPages, TInt aSize, TInt aWorkers, PageCache* aCache);
 
 		~CBytePairCompressedImage();
 
-		void AddPage(TUint16 aPageNum, TUint8 * aPageData, TUint16 aPageSize);
-		int  GetPage(TUint16 aPageNum, TUint8 * aPageData);
-		void WriteOutTable(std::ofstream &os);
-		int  ReadInTable(std::ifstream &is, TUint & aNumberOfPages);
+		void AddPage(TUint16 aPageNum, TUint8 * aPageData, TUint16 aPageSize, BytePairContext& aContext, TInt aWorker);
+		void ReportPageClasses();
+		void BuildTable(std::vector<TUint8>& aTable);
 
 	private:
-		TInt ConstructL( TUint16 aNumberOfPages, TInt aSize);
+		TInt ConstructL( TUint16 aNumberOfPages, TInt aSize, TInt aWorkers, PageCache* aCache);
 		CBytePairCompressedImage();
 
 	private:
 		IndexTableHeader 	iHeader;
-		IndexTableItem*		iPages;
-		TUint8* 			iOutBuffer;
+		std::vector<IndexTableItem>	iPages;
+		// compressed pages, every worker appends to its own arena
+		std::vector<std::vector<TUint8> >	iArenas;
+		std::atomic<TInt>	iPageClasses[EPageClasses] = {};
+		PageCache*			iCache = nullptr;
 };
 
 
 CBytePairCompressedImage::CBytePairCompressedImage() {}
 
 
-CBytePairCompressedImage* CBytePairCompressedImage::NewLC(TUint16 aNumberOfPages, TInt aSize)
+CBytePairCompressedImage* CBytePairCompressedImage::NewLC(TUint16 aNumberOfPages, TInt aSize, TInt aWorkers, PageCache* aCache)
 {
 	CBytePairCompressedImage* self = new CBytePairCompressedImage;
 	if( nullptr == self)
@@ -79,228 +104,355 @@ CBytePairCompressedImage* CBytePairCompressedImage::NewLC(TUint16 aNumberOfPages
 		return self;
 	}
 
-	if( KErrNone == self->ConstructL(aNumberOfPages, aSize))
+	if( KErrNone == self->ConstructL(aNumberOfPages, aSize, aWorkers, aCache))
 	{
 		return self;
 	}
+	delete self;
 	return nullptr;
 }
 
 
-TInt CBytePairCompressedImage::ConstructL(TUint16 aNumberOfPages, TInt aSize)
+TInt CBytePairCompressedImage::ConstructL(TUint16 aNumberOfPages, TInt aSize, TInt aWorkers, PageCache* aCache)
 {
-	//Print(EWarning,"Start ofCBytePairCompressedImage::ConstructL(%d, %d)\n", aNumberOfPages, aSize );
 	iHeader.iNumberOfPages = aNumberOfPages;
 	iHeader.iDecompressedSize = aSize;
+	iCache = aCache;
 
-	if( 0 != aNumberOfPages)
-	{
-		iPages = (IndexTableItem *) calloc(aNumberOfPages, sizeof(IndexTableItem));
-
-		if( nullptr == iPages )
-		{
-			return KErrNoMemory;
-		}
-	}
+	iPages.resize(aNumberOfPages);
+	iArenas.resize(aWorkers);
+	// code usually compresses to about a half, arenas grow if it doesn't
+	for(auto &arena: iArenas)
+		arena.reserve((aSize / aWorkers + PAGE_SIZE) / 2);
 
 	iHeader.iSizeOfData = 	sizeof(iHeader.iSizeOfData) +
 							sizeof(iHeader.iDecompressedSize) +
 							sizeof(iHeader.iNumberOfPages) +
 							aNumberOfPages * sizeof(TUint16);
 
-	iOutBuffer = (TUint8 *) calloc(4 * PAGE_SIZE, sizeof(TUint8) );
-
-	if ( nullptr == iOutBuffer)
-	{
-		return KErrNoMemory;
-	}
 	return KErrNone;
 } // End of ConstructL()
 
-CBytePairCompressedImage::~CBytePairCompressedImage()
-{
+CBytePairCompressedImage::~CBytePairCompressedImage() {}
 
-	for( int i = 0; i < iHeader.iNumberOfPages; i++)
+
+/**
+Classify a page by its byte histogram.
+@param aCounts - byte histogram of the page
+@param aPageSize - size of the page
+*/
+static TPageClass ClassifyPage(const TUint16* aCounts, TInt aPageSize)
+{
+	TInt values = 0;
+	double entropy = 0;
+	for(TInt b = 0; b < 0x100; b++)
 	{
-		free(iPages[i].iCompressedPageData);
-		iPages[i].iCompressedPageData = nullptr;
+		if(!aCounts[b])
+			continue;
+		++values;
+		double p = (double)aCounts[b] / aPageSize;
+		entropy -= p * std::log2(p);
 	}
-
-	free( iPages );
-	iPages = nullptr;
-
-	free( iOutBuffer );
-	iOutBuffer = nullptr;
+	if(values == 1)
+		return EPageConstant;
+	if(entropy >= KHighEntropy)
+		return EPageIncompressible;
+	return EPageOther;
 }
 
 
-void CBytePairCompressedImage::AddPage(TUint16 aPageNum, TUint8 * aPageData, TUint16 aPageSize)
+/**
+Compress a single page into the arena of the worker. Different pages may be
+added concurrently provided that every worker uses its own compression context.
+
+Constant pages and pages with no pair frequent enough to make a token get
+their encoding directly, without the pair search of Pak(). The result is the
+same as from Pak(). Other pages are looked up in the page cache, if any,
+before Pak() is used.
+*/
+void CBytePairCompressedImage::AddPage(TUint16 aPageNum, TUint8 * aPageData, TUint16 aPageSize, BytePairContext& aContext, TInt aWorker)
 {
 	//Print(EWarning,"Start of AddPage(aPageNum:%d, ,aPageSize:%d)\n",aPageNum, aPageSize );
 
-#ifdef __TEST_ONLY__
-
-	iPages[aPageNum].iSizeOfCompressedPageData = 2;
-
-	iPages[aPageNum].iCompressedPageData = (TUint8 *) calloc(iPages[aPageNum].iSizeOfCompressedPageData, sizeof(TUint8) );
+	TUint8 outBuffer[4 * PAGE_SIZE];
+	TUint16 compressedSize;
 
-	memcpy(iPages[aPageNum].iCompressedPageData, (TUint8 *) &aPageNum, iPages[aPageNum].iSizeOfCompressedPageData);
+#ifdef __TEST_ONLY__
 
+	compressedSize = 2;
+	memcpy(outBuffer, (TUint8 *) &aPageNum, compressedSize);
 
 #else
 
-	TUint16 compressedSize = (TUint16) Pak(iOutBuffer,aPageData,aPageSize );
-	iPages[aPageNum].iSizeOfCompressedPageData = compressedSize;
-	//Print(EWarning,"Compressed page size:%d\n", iPages[aPageNum].iSizeOfCompressedPageData );
-
-	iPages[aPageNum].iCompressedPageData = (TUint8 *) calloc(iPages[aPageNum].iSizeOfCompressedPageData, sizeof(TUint8) );
-
-	if( nullptr == iPages[aPageNum].iCompressedPageData )
+	TPageClass pageClass = ClassifyPage(aContext.CountBytes(aPageData, aPageSize), aPageSize);
+	if(pageClass == EPageConstant)
 	{
-		return;
+		compressedSize = (TUint16) aContext.PakRun(outBuffer, aPageData[0], aPageSize);
 	}
-
-	memcpy(iPages[aPageNum].iCompressedPageData, iOutBuffer, iPages[aPageNum].iSizeOfCompressedPageData );
-
-#endif
-
-	iHeader.iSizeOfData += iPages[aPageNum].iSizeOfCompressedPageData;
-}
-
-void CBytePairCompressedImage::WriteOutTable(std::ofstream & os)
-{
-	// Write out IndexTableHeader
-	//Print(EWarning,"Write out IndexTableHeader(iSizeOfData:%d,iDecompressedSize:%d,iNumberOfPages:%d)\n",iHeader.iSizeOfData, iHeader.iDecompressedSize, iHeader.iNumberOfPages );
-	//Print(EWarning,"sizeof(IndexTableHeader) = %d, , sizeof(TUint16) = %d\n",sizeof(IndexTableHeader), sizeof(TUint16) );
-	//os.write((const char *) &iHeader, sizeof(IndexTableHeader));
-	os.write((const char *) &iHeader.iSizeOfData, sizeof(iHeader.iSizeOfData));
-	os.write((const char *) &iHeader.iDecompressedSize, sizeof(iHeader.iDecompressedSize));
-	os.write((const char *) &iHeader.iNumberOfPages, sizeof(iHeader.iNumberOfPages));
-
-
-	// Write out IndexTableItems (size of each compressed page)
-	for(TInt i = 0; i < iHeader.iNumberOfPages; i++)
+	else if(pageClass == EPageIncompressible && aContext.StoresRaw(aPageData, aPageSize))
 	{
-		os.write((const char *) &(iPages[i].iSizeOfCompressedPageData), sizeof(TUint16));
+		outBuffer[0] = 0; // zero token count
+		memcpy(outBuffer + 1, aPageData, aPageSize);
+		compressedSize = (TUint16) (aPageSize + 1);
 	}
-
-	// Write out compressed pages
-	for(TInt i = 0; i < iHeader.iNumberOfPages; i++)
+	else
 	{
-		os.write( (const char *)iPages[i].iCompressedPageData, iPages[i].iSizeOfCompressedPageData);
+		if(pageClass == EPageIncompressible)
+			pageClass = EPageOther;
+		TInt size;
+		if(!iCache || !iCache->Lookup(aPageData, aPageSize, outBuffer, size))
+		{
+			size = aContext.Pak(outBuffer,aPageData,aPageSize );
+			if(iCache)
+				iCache->Store(aPageData, aPageSize, outBuffer, size);
+		}
+		compressedSize = (TUint16) size;
 	}
-}
-
-
-int CBytePairCompressedImage::ReadInTable(std::ifstream &is, TUint & aNumberOfPages)
-{
-	// Read page index table header
-	is.read((char *)&iHeader, (sizeof(iHeader.iSizeOfData)+sizeof(iHeader.iDecompressedSize)+sizeof(iHeader.iNumberOfPages)));
-
-	// Allocatin place to Page index table entries
-	iPages = (IndexTableItem *) calloc(iHeader.iNumberOfPages, sizeof(IndexTableItem));
+	++iPageClasses[pageClass];
 
-	if( nullptr == iPages )
-	{
-		return KErrNoMemory;
-	}
+#endif
 
-	// Read whole Page index table
+	std::vector<TUint8>& arena = iArenas[aWorker];
+	IndexTableItem& page = iPages[aPageNum];
+	page.iSizeOfCompressedPageData = compressedSize;
+	page.iArena = (TUint16)aWorker;
+	page.iOffset = (TUint32)arena.size();
+	arena.insert(arena.end(), outBuffer, outBuffer + compressedSize);
+}
 
-	for(TInt i = 0; i < iHeader.iNumberOfPages; i++)
+/**
+Append the index table followed by the compressed pages in page order.
+The table is built in place, the arenas are released.
+@param aTable - buffer to append to
+*/
+void CBytePairCompressedImage::BuildTable(std::vector<TUint8>& aTable)
+{
+	// pages could be added in any order, so sum up their sizes here
+	for(const IndexTableItem& page: iPages)
+		iHeader.iSizeOfData += page.iSizeOfCompressedPageData;
+
+	size_t start = aTable.size();
+	aTable.resize(start + iHeader.iSizeOfData);
+	TUint8* out = &aTable[start];
+
+	// IndexTableHeader
+	memcpy(out, &iHeader.iSizeOfData, sizeof(iHeader.iSizeOfData));
+	out += sizeof(iHeader.iSizeOfData);
+	memcpy(out, &iHeader.iDecompressedSize, sizeof(iHeader.iDecompressedSize));
+	out += sizeof(iHeader.iDecompressedSize);
+	memcpy(out, &iHeader.iNumberOfPages, sizeof(iHeader.iNumberOfPages));
+	out += sizeof(iHeader.iNumberOfPages);
+
+	// IndexTableItems (size of each compressed page)
+	for(const IndexTableItem& page: iPages)
 	{
-		is.read((char *) &(iPages[i].iSizeOfCompressedPageData), sizeof(TUint16));
+		memcpy(out, &page.iSizeOfCompressedPageData, sizeof(TUint16));
+		out += sizeof(TUint16);
 	}
 
-	// Read compressed data pages page by page, decompress and store them
-	for(TInt i = 0; i < iHeader.iNumberOfPages; i++)
+	// compressed pages
+	for(const IndexTableItem& page: iPages)
 	{
-
-		iPages[i].iCompressedPageData = (TUint8 *) calloc(iPages[i].iSizeOfCompressedPageData, sizeof(TUint8) );
-
-		if( nullptr == iPages[i].iCompressedPageData )
-		{
-			return KErrNoMemory;
-		}
-
-		is.read((char *)iPages[i].iCompressedPageData, iPages[i].iSizeOfCompressedPageData);
+		memcpy(out, &iArenas[page.iArena][page.iOffset], page.iSizeOfCompressedPageData);
+		out += page.iSizeOfCompressedPageData;
 	}
-
-	aNumberOfPages = iHeader.iNumberOfPages;
-
-	return KErrNone;
+	iArenas.clear();
 }
 
-int  CBytePairCompressedImage::GetPage(TUint16 aPageNum, TUint8 * aPageData)
-{
-	TUint8* pakEnd;
-
-    const TInt MaxBlockSize = 0x1000;
-
-   	TUint16 uncompressedSize = (TUint16) Unpak( aPageData,
-												MaxBlockSize,
-												iPages[aPageNum].iCompressedPageData,
-												iPages[aPageNum].iSizeOfCompressedPageData,
-												pakEnd );
 
-	return uncompressedSize;
+/**
+Print how many pages of every class were added.
+*/
+void CBytePairCompressedImage::ReportPageClasses()
+{
+	std::ostringstream report;
+	report << "Byte-pair pages: " << iHeader.iNumberOfPages << " total, "
+		<< iPageClasses[EPageConstant] << " constant, "
+		<< iPageClasses[EPageIncompressible] << " incompressible, "
+		<< iPageClasses[EPageOther] << " other";
+	Message::GetInstance()->Output(report.str());
 }
 
 
-void CompressPages(TUint8* bytes, TInt size, std::ofstream& os)
+/**
+Byte-pair compress the data page by page.
+@param bytes - data to compress
+@param size - size of data
+@param aTable - the index table followed by the compressed pages is appended to it
+@param aJobs - number of threads for page compression, 0 - one per CPU core.
+The output does not depend on the number of threads.
+@param aPageStats - print how many pages took every compression path
+@param aCache - cache of compressed pages or nullptr
+*/
+void CompressPages(TUint8* bytes, TInt size, std::vector<TUint8>& aTable, TInt aJobs, bool aPageStats, PageCache* aCache)
 {
 	// Build a list of compressed pages
 	TUint16 numOfPages = (TUint16) ((size + PAGE_SIZE - 1) / PAGE_SIZE);
+	TInt workers = WorkerCount(aJobs, numOfPages);
 
-	CBytePairCompressedImage* comprImage = CBytePairCompressedImage::NewLC(numOfPages, size);
+	std::unique_ptr<CBytePairCompressedImage> comprImage(CBytePairCompressedImage::NewLC(numOfPages, size, workers, aCache));
 	if (!comprImage)
 	{
 		//Print(EError," NULL == comprImage\n");
 		return;
 	}
 
-	TUint pageNum;
-	TUint remain = (TUint)size;
-	for (pageNum=0; pageNum<numOfPages; ++pageNum)
+	std::vector<std::unique_ptr<BytePairContext> > contexts(workers);
+	for(auto &context: contexts)
+		context.reset(new BytePairContext);
+
+	ParallelFor(numOfPages, aJobs, [&](int pageNum, int worker)
 	{
 		TUint8* pageStart = bytes + pageNum * PAGE_SIZE;
+		TUint remain = (TUint)size - pageNum * PAGE_SIZE;
 		TUint pageLen = remain>PAGE_SIZE ? PAGE_SIZE : remain;
-		comprImage->AddPage((TUint16)pageNum, pageStart, (TUint16)pageLen);
-		remain -= pageLen;
-	}
+		comprImage->AddPage((TUint16)pageNum, pageStart, (TUint16)pageLen, *contexts[worker], worker);
+	});
 
-	// Write out index table and compressed pages
-	comprImage->WriteOutTable(os);
+	if(aPageStats)
+		comprImage->ReportPageClasses();
 
-	delete comprImage;
-	comprImage = nullptr;
+	comprImage->BuildTable(aTable);
 }
 
 
-int DecompressPages(TUint8 * bytes, std::ifstream& is)
+/**
+Byte-pair compress the data page by page and write out the index table
+followed by the compressed pages with a single write.
+@param bytes - data to compress
+@param size - size of data
+@param os - output stream
+@param aJobs - number of threads for page compression, 0 - one per CPU core.
+@param aPageStats - print how many pages took every compression path
+@param aCache - cache of compressed pages or nullptr
+*/
+void CompressPages(TUint8* bytes, TInt size, std::ofstream& os, TInt aJobs, bool aPageStats, PageCache* aCache)
 {
-	CBytePairCompressedImage *comprImage = CBytePairCompressedImage::NewLC(0, 0);
-	if( nullptr == comprImage)
+	std::vector<TUint8> table;
+	CompressPages(bytes, size, table, aJobs, aPageStats, aCache);
+	os.write((const char *)table.data(), table.size());
+}
+
+
+/**
+Parse the index table.
+@param aData - index table followed by the compressed pages
+@param aSize - size of aData, may include data after the pages
+@return KErrNone or KErrCorrupt if the table doesn't fit or is inconsistent
+*/
+TInt BytePairImageView::Open(const TUint8* aData, size_t aSize)
+{
+	const size_t headerSize = sizeof(IndexTableHeader::iSizeOfData) +
+		sizeof(IndexTableHeader::iDecompressedSize) + sizeof(IndexTableHeader::iNumberOfPages);
+	iData = nullptr;
+	iPageOffsets.clear();
+	if(aSize < headerSize)
+		return KErrCorrupt;
+
+	IndexTableHeader header;
+	memcpy(&header.iSizeOfData, aData, sizeof(header.iSizeOfData));
+	memcpy(&header.iDecompressedSize, aData + 4, sizeof(header.iDecompressedSize));
+	memcpy(&header.iNumberOfPages, aData + 8, sizeof(header.iNumberOfPages));
+	TUint numOfPages = header.iNumberOfPages;
+	size_t offset = headerSize + numOfPages * sizeof(TUint16);
+	if(aSize < offset || header.iDecompressedSize < 0 ||
+		(TUint)header.iDecompressedSize > numOfPages * PAGE_SIZE)
+		return KErrCorrupt;
+
+	// page offsets are the prefix sums of the page sizes
+	iPageOffsets.resize(numOfPages + 1);
+	const TUint8* sizes = aData + headerSize;
+	for(TUint i = 0; i < numOfPages; i++)
 	{
-		//Print(EError," NULL == comprImage\n");
-		return KErrNoMemory;
+		TUint16 size;
+		memcpy(&size, sizes + i * sizeof(TUint16), sizeof(TUint16));
+		iPageOffsets[i] = (TUint32)offset;
+		offset += size;
+	}
+	iPageOffsets[numOfPages] = (TUint32)offset;
+	if(offset != (TUint)header.iSizeOfData || offset > aSize)
+	{
+		iPageOffsets.clear();
+		return KErrCorrupt;
 	}
 
-	TUint numberOfPages = 0;
-	comprImage->ReadInTable(is, numberOfPages);
+	iData = aData;
+	iDecompressedSize = header.iDecompressedSize;
+	return KErrNone;
+}
 
-	TUint16 iPage = 0;
-	TUint decompressedSize = 0;
+TUint BytePairImageView::PageCount() const
+{
+	return iPageOffsets.empty() ? 0 : (TUint)iPageOffsets.size() - 1;
+}
 
-	while(iPage < numberOfPages )
-	{
-		TUint8* iPageStart = &bytes[iPage * PAGE_SIZE];
+/**
+@return size of the index table and the compressed pages
+*/
+size_t BytePairImageView::TableSize() const
+{
+	return iPageOffsets.empty() ? 0 : iPageOffsets.back();
+}
 
-		decompressedSize += comprImage->GetPage(iPage, iPageStart);
+/**
+@return decompressed size of the page, only the last one may be short of PAGE_SIZE
+*/
+TInt BytePairImageView::PageSize(TUint aPage) const
+{
+	TInt remain = iDecompressedSize - (TInt)aPage * PAGE_SIZE;
+	return remain > PAGE_SIZE ? PAGE_SIZE : remain;
+}
 
-		++iPage;
-	}
+/**
+Decompress one page.
+@param aPage - page number
+@param aDst - destination of PageSize(aPage) bytes
+@return size of the page or KErrCorrupt
+*/
+TInt BytePairImageView::DecompressPage(TUint aPage, TUint8* aDst) const
+{
+	if(aPage >= PageCount())
+		return KErrCorrupt;
+	TUint8* pakEnd;
+	TInt size = PageSize(aPage);
+	TInt decompressed = Unpak(aDst, size, (TUint8*)iData + iPageOffsets[aPage],
+		iPageOffsets[aPage + 1] - iPageOffsets[aPage], pakEnd);
+	return decompressed == size ? size : KErrCorrupt;
+}
+
+/**
+Decompress all pages of a byte-pair compressed part of an image in memory.
+@param bytes - destination of the decompressed data
+@param aBytesSize - size of the destination, pages past it are not decompressed
+@param aData - index table followed by the compressed pages
+@param aSize - size of aData, may include data after the pages
+@param aTableSize - returns size of the table and the pages, 0 if the table is corrupt
+@param aJobs - number of threads for page decompression, 0 - one per CPU core
+@return size of the decompressed data, without the pages which are corrupt
+*/
+int DecompressPages(TUint8* bytes, size_t aBytesSize, const TUint8* aData, size_t aSize, size_t& aTableSize, TInt aJobs)
+{
+	aTableSize = 0;
+	BytePairImageView view;
+	if(view.Open(aData, aSize) != KErrNone)
+		return 0;
+	aTableSize = view.TableSize();
+
+	TUint numOfPages = 0;
+	while(numOfPages < view.PageCount() &&
+		(size_t)numOfPages * PAGE_SIZE + view.PageSize(numOfPages) <= aBytesSize)
+		++numOfPages;
+
+	// pages are independent, the view knows where each one starts
+	std::vector<TInt> sizes(numOfPages);
+	ParallelFor(numOfPages, aJobs, [&](int pageNum, int)
+	{
+		TInt size = view.DecompressPage(pageNum, bytes + pageNum * PAGE_SIZE);
+		sizes[pageNum] = size > 0 ? size : 0;
+	});
 
-	delete comprImage;
+	TInt decompressedSize = 0;
+	for(TInt size: sizes)
+		decompressedSize += size;
 	return decompressedSize;
 }
@@ -0,0 +1,64 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Byte-pair compression of E32 images page by page for the elf2e32 tool
+// @internalComponent
+// @released
+//
+//
+
+#ifndef PAGEDCOMPRESS_H
+#define PAGEDCOMPRESS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+class PageCache;
+
+void CompressPages(uint8_t* bytes, int32_t size, std::ofstream& os, int32_t aJobs, bool aPageStats,
+    PageCache* aCache = nullptr);
+void CompressPages(uint8_t* bytes, int32_t size, std::vector<uint8_t>& aTable, int32_t aJobs, bool aPageStats,
+    PageCache* aCache = nullptr);
+int DecompressPages(uint8_t* bytes, size_t aBytesSize, const uint8_t* aData, size_t aSize, size_t& aTableSize,
+    int32_t aJobs = 1);
+
+/**
+Byte-pair compressed part of an image in memory: the index table followed by
+the compressed pages, as written by CompressPages().
+
+Open() parses only the index table, pages are decompressed when asked for,
+each on its own. The data must stay valid while the view is used.
+@internalComponent
+@released
+*/
+class BytePairImageView
+{
+    public:
+        int32_t Open(const uint8_t* aData, size_t aSize);
+
+        uint32_t PageCount() const;
+        size_t TableSize() const;
+        int32_t PageSize(uint32_t aPage) const;
+
+        int32_t DecompressPage(uint32_t aPage, uint8_t* aDst) const;
+
+    private:
+        const uint8_t* iData = nullptr;
+        int32_t iDecompressedSize = 0;
+        // offsets of the compressed pages in iData, one more for the end
+        std::vector<uint32_t> iPageOffsets;
+};
+
+#endif // PAGEDCOMPRESS_H
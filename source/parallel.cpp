@@ -0,0 +1,76 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Minimal worker pool for the independent pages of compressed images
+// @internalComponent
+// @released
+//
+//
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+
+#include "parallel.h"
+
+int WorkerCount(int aJobs, int aCount)
+{
+    if(aJobs <= 0)
+        aJobs = std::thread::hardware_concurrency();
+    if(aJobs > aCount)
+        aJobs = aCount;
+    return aJobs > 1 ? aJobs : 1;
+}
+
+void ParallelFor(int aCount, int aJobs, const std::function<void(int, int)>& aFunc)
+{
+    int workers = WorkerCount(aJobs, aCount);
+    if(workers == 1)
+    {
+        for(int i = 0; i < aCount; ++i)
+            aFunc(i, 0);
+        return;
+    }
+
+    std::atomic<int> next(0);
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    auto worker = [&](int aWorker)
+    {
+        try
+        {
+            for(int i = next++; i < aCount; i = next++)
+                aFunc(i, aWorker);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(errorLock);
+            if(!error)
+                error = std::current_exception();
+            next = aCount; // stop handing out work
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(int w = 1; w < workers; ++w)
+        pool.emplace_back(worker, w);
+    worker(0);
+    for(auto &t: pool)
+        t.join();
+
+    if(error)
+        std::rethrow_exception(error);
+}
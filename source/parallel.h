@@ -0,0 +1,43 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Minimal worker pool for the independent pages of compressed images
+// @internalComponent
+// @released
+//
+//
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+/**
+Number of worker threads that will be used for aCount work items.
+@param aJobs - requested number of threads, 0 means one per CPU core
+@param aCount - number of work items
+*/
+int WorkerCount(int aJobs, int aCount);
+
+/**
+Calls aFunc(index, worker) once for every index in [0, aCount).
+
+Items are handed out in ascending order to WorkerCount(aJobs, aCount) threads,
+worker is in range [0, WorkerCount()) and can be used to select per-thread
+state. With a single worker everything runs on the calling thread.
+The first exception thrown by aFunc is rethrown to the caller after all
+workers have stopped.
+*/
+void ParallelFor(int aCount, int aJobs, const std::function<void(int, int)>& aFunc);
+
+#endif // PARALLEL_H
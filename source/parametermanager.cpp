@@ -30,6 +30,7 @@
 #include "h_ver.h"
 #include "pl_common.h"
 #include "errorhandler.h"
+#include "huffman.h"
 #include "parametermanager.h"
 
 using std::endl;
@@ -392,6 +393,31 @@ const ParameterManager::OptionDesc ParameterManager::iOptions[] =
 		(void*)ParameterManager::ParseSmpSafe,
 		"SMP Safe",
 	},
+	{
+		"jobs",
+		(void*)ParameterManager::ParseJobs,
+		"Number of threads for image (de)compression, 0 - one per CPU core",
+	},
+	{
+		"pagestats",
+		(void*)ParameterManager::ParsePageStats,
+		"Print how the pages of byte-pair compressed images were encoded",
+	},
+	{
+		"pagecache",
+		(void*)ParameterManager::ParsePageCache,
+		"Directory to cache byte-pair compressed pages between builds",
+	},
+	{
+		"pagecachesize",
+		(void*)ParameterManager::ParsePageCacheSize,
+		"Size limit of the page cache in megabytes, 256 by default",
+	},
+	{
+		"deflatelevel",
+		(void*)ParameterManager::ParseDeflateLevel,
+		"Match search effort of inflate compression, 1 (fastest) to 9 (default) or max (smallest, slow)",
+	},
 	{
 		"help",
 		(void *)ParameterManager::ParamHelp,
@@ -1326,6 +1352,66 @@ bool ParameterManager::IsSmpSafe(){
 	return iSmpSafe;
 }
 
+/**
+This function extracts the number of worker threads passed to the --jobs option.
+
+@internalComponent
+@released
+
+@return the number of threads for image (de)compression, 0 means one per CPU core.
+*/
+UINT ParameterManager::Jobs(){
+	return iJobs;
+}
+
+/**
+This function extracts the information whether --pagestats option is passed.
+
+@internalComponent
+@released
+
+@return True if page statistics of byte-pair compression are printed.
+*/
+bool ParameterManager::PageStats(){
+	return iPageStats;
+}
+
+/**
+This function extracts the page cache directory passed to the --pagecache option.
+
+@internalComponent
+@released
+
+@return the page cache directory or nullptr if pages are not cached.
+*/
+char * ParameterManager::PageCacheDir(){
+	return iPageCacheDir;
+}
+
+/**
+This function extracts the page cache size passed to the --pagecachesize option.
+
+@internalComponent
+@released
+
+@return the size limit of the page cache in megabytes.
+*/
+UINT ParameterManager::PageCacheSize(){
+	return iPageCacheSize;
+}
+
+/**
+This function extracts the deflate level passed to the --deflatelevel option.
+
+@internalComponent
+@released
+
+@return the match search effort of inflate compression, 1 to KDeflateOptimalLevel.
+*/
+UINT ParameterManager::DeflateLevel(){
+	return iDeflateLevel;
+}
+
 /**
 This function extracts the filename from the absolute path that is given as input.
 
@@ -2532,6 +2618,134 @@ DEFINE_PARAM_PARSER(ParameterManager::ParseSmpSafe)
 	aPM->SetSmpSafe(true);
 }
 
+/**
+This function sets the number of worker threads passed to the --jobs option.
+
+void ParameterManager::ParseJobs(ParameterManager * aPM, char * aOption, char * aValue, void * aDesc)
+
+@internalComponent
+@released
+
+@param aPM
+Pointer to the ParameterManager
+@param aOption
+Option that is passed as input, in this case --jobs
+@param aValue
+The number of threads passed to --jobs option
+@param aDesc
+Pointer to function ParameterManager::ParseJobs returning void.
+*/
+DEFINE_PARAM_PARSER(ParameterManager::ParseJobs)
+{
+	INITIALISE_PARAM_PARSER;
+	UINT jobs = ValidateInputVal(aValue, "--jobs");
+	aPM->SetJobs(jobs);
+}
+
+/**
+This function sets iPageStats if --pagestats is passed in.
+
+void ParameterManager::ParsePageStats(ParameterManager * aPM, char * aOption, char * aValue, void * aDesc)
+
+@internalComponent
+@released
+
+@param aPM
+Pointer to the ParameterManager
+@param aOption
+Option that is passed as input, in this case --pagestats
+@param aValue
+The value passed to --pagestats option, in this case NULL
+@param aDesc
+Pointer to function ParameterManager::ParsePageStats returning void.
+*/
+DEFINE_PARAM_PARSER(ParameterManager::ParsePageStats)
+{
+	INITIALISE_PARAM_PARSER;
+	CheckInput(aValue, "--pagestats");
+	aPM->SetPageStats(true);
+}
+
+/**
+This function sets the page cache directory passed to the --pagecache option.
+
+void ParameterManager::ParsePageCache(ParameterManager * aPM, char * aOption, char * aValue, void * aDesc)
+
+@internalComponent
+@released
+
+@param aPM
+Pointer to the ParameterManager
+@param aOption
+Option that is passed as input, in this case --pagecache
+@param aValue
+The directory passed to --pagecache option
+@param aDesc
+Pointer to function ParameterManager::ParsePageCache returning void.
+*/
+DEFINE_PARAM_PARSER(ParameterManager::ParsePageCache)
+{
+	INITIALISE_PARAM_PARSER;
+	if (!aValue)
+		throw Elf2e32Error(NOARGUMENTERROR, "--pagecache");
+	aPM->SetPageCacheDir(aValue);
+}
+
+/**
+This function sets the page cache size passed to the --pagecachesize option.
+
+void ParameterManager::ParsePageCacheSize(ParameterManager * aPM, char * aOption, char * aValue, void * aDesc)
+
+@internalComponent
+@released
+
+@param aPM
+Pointer to the ParameterManager
+@param aOption
+Option that is passed as input, in this case --pagecachesize
+@param aValue
+The size in megabytes passed to --pagecachesize option
+@param aDesc
+Pointer to function ParameterManager::ParsePageCacheSize returning void.
+*/
+DEFINE_PARAM_PARSER(ParameterManager::ParsePageCacheSize)
+{
+	INITIALISE_PARAM_PARSER;
+	UINT size = ValidateInputVal(aValue, "--pagecachesize");
+	aPM->SetPageCacheSize(size);
+}
+
+/**
+This function sets the deflate level passed to the --deflatelevel option.
+
+void ParameterManager::ParseDeflateLevel(ParameterManager * aPM, char * aOption, char * aValue, void * aDesc)
+
+@internalComponent
+@released
+
+@param aPM
+Pointer to the ParameterManager
+@param aOption
+Option that is passed as input, in this case --deflatelevel
+@param aValue
+The level passed to --deflatelevel option
+@param aDesc
+Pointer to function ParameterManager::ParseDeflateLevel returning void.
+*/
+DEFINE_PARAM_PARSER(ParameterManager::ParseDeflateLevel)
+{
+	INITIALISE_PARAM_PARSER;
+	if (aValue && !strcmp(aValue, "max"))
+	{
+		aPM->SetDeflateLevel(KDeflateOptimalLevel);
+		return;
+	}
+	UINT level = ValidateInputVal(aValue, "--deflatelevel");
+	if (level < 1 || level > (UINT)KDeflateMaxLevel)
+		throw Elf2e32Error(INVALIDARGUMENTERROR, aValue, "--deflatelevel");
+	aPM->SetDeflateLevel(level);
+}
+
 static const TargetTypeDesc DefaultTargetTypes[] =
 {
 	{ "DLL", EDll },
@@ -3204,6 +3418,76 @@ void ParameterManager::SetSmpSafe(bool aVal)
 	iSmpSafe = aVal;
 }
 
+/**
+This function sets iJobs if --jobs is passed in.
+
+@internalComponent
+@released
+
+@param aJobs
+Number of threads passed to '--jobs' option.
+*/
+void ParameterManager::SetJobs(UINT aJobs)
+{
+	iJobs = aJobs;
+}
+
+/**
+This function sets iPageStats if --pagestats is passed in.
+
+@internalComponent
+@released
+
+@param aVal
+True if --pagestats is passed in.
+*/
+void ParameterManager::SetPageStats(bool aVal)
+{
+	iPageStats = aVal;
+}
+
+/**
+This function sets iPageCacheDir if --pagecache is passed in.
+
+@internalComponent
+@released
+
+@param aDir
+Directory passed to '--pagecache' option.
+*/
+void ParameterManager::SetPageCacheDir(char * aDir)
+{
+	iPageCacheDir = aDir;
+}
+
+/**
+This function sets iPageCacheSize if --pagecachesize is passed in.
+
+@internalComponent
+@released
+
+@param aSize
+Size in megabytes passed to '--pagecachesize' option.
+*/
+void ParameterManager::SetPageCacheSize(UINT aSize)
+{
+	iPageCacheSize = aSize;
+}
+
+/**
+This function sets iDeflateLevel if --deflatelevel is passed in.
+
+@internalComponent
+@released
+
+@param aLevel
+Level passed to '--deflatelevel' option.
+*/
+void ParameterManager::SetDeflateLevel(UINT aLevel)
+{
+	iDeflateLevel = aLevel;
+}
+
 //Internal support functions
 
 void ValidateDSOGeneration(ParameterManager *param)
@@ -162,6 +162,11 @@ public:
 	DECLARE_PARAM_PARSER(ParseSymNamedLookup);
 	DECLARE_PARAM_PARSER(ParseDebuggable);
 	DECLARE_PARAM_PARSER(ParseSmpSafe);
+	DECLARE_PARAM_PARSER(ParseJobs);
+	DECLARE_PARAM_PARSER(ParsePageStats);
+	DECLARE_PARAM_PARSER(ParsePageCache);
+	DECLARE_PARAM_PARSER(ParsePageCacheSize);
+	DECLARE_PARAM_PARSER(ParseDeflateLevel);
 
 	/**
     This function parses the command line options and sets the appropriate values based on the
@@ -208,6 +213,11 @@ public:
 	void SetSymNamedLookup(bool aVal);
 	void SetDebuggable(bool aVal);
 	void SetSmpSafe(bool aVal);
+	void SetJobs(UINT aJobs);
+	void SetPageStats(bool aVal);
+	void SetPageCacheDir(char * aDir);
+	void SetPageCacheSize(UINT aSize);
+	void SetDeflateLevel(UINT aLevel);
 
 	int NumOptions();
 	int NumShortOptions();
@@ -344,6 +354,11 @@ public:
 	bool SymNamedLookup();
 	bool IsDebuggable();
 	bool IsSmpSafe();
+	UINT Jobs();
+	bool PageStats();
+	char * PageCacheDir();
+	UINT PageCacheSize();
+	UINT DeflateLevel();
 
 	E32ImageHeader *GetE32Header();
 	SSecurityInfo *GetSSecurityInfo();
@@ -424,6 +439,11 @@ private:
 	bool iDebuggable = false;
 	bool iSmpSafe = false;
 	bool iSSTDDll = false;
+	UINT iJobs = 1;
+	bool iPageStats = false;
+	char * iPageCacheDir = nullptr;
+	UINT iPageCacheSize = 256;
+	UINT iDeflateLevel = 9;
 };
 
 
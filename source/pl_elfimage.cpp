@@ -21,13 +21,15 @@
 
 #include <stdio.h>
 #include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <unordered_set>
 
 #include "message.h"
 #include "pl_symbol.h"
 #include "pl_elfimage.h"
 #include "errorhandler.h"
-#include "pl_elflocalrelocation.h"
+#include "pl_elfrelocation.h"
 
 using std::list;
 using std::cout;
@@ -65,6 +67,8 @@ ElfImage::~ElfImage()
 
 	iNeeded.clear();
 //	iSymbolTable.clear();
+	if(iMapping.Data())
+		iMemBlock = nullptr;	// unmapped by iMapping
 	DELETE_PTR_ARRAY(iMemBlock);
 }
 
@@ -137,6 +141,13 @@ void ElfImage::ProcessElfFile(Elf32_Ehdr *aElfHdr) {
 			aIdx++;
 		}
 
+		if( iCodeSegmentHdr ) {
+			iSegmentRanges[0] = {iCodeSegmentHdr->p_vaddr, iCodeSegmentHdr->p_memsz, iCodeSegmentHdr, ESegmentRO};
+		}
+		if( iDataSegmentHdr ) {
+			iSegmentRanges[1] = {iDataSegmentHdr->p_vaddr, iDataSegmentHdr->p_memsz, iDataSegmentHdr, ESegmentRW};
+		}
+
 		if( iDynSegmentHdr ) {
 			ProcessDynamicEntries();
 		}
@@ -153,6 +164,10 @@ Function to Find the Static Symbol Table
 */
 void ElfImage::FindStaticSymbolTable()
 {
+	if (iStaticSymbolsFound)
+		return;
+	iStaticSymbolsFound = true;
+
 	size_t nShdrs = iElfHeader->e_shnum;
 
 	if (nShdrs)
@@ -166,7 +181,7 @@ void ElfImage::FindStaticSymbolTable()
 				iLim = ELF_ENTRY_PTR(Elf32_Sym, iSymTab, iSections[i].sh_size);
 				if (iStrTab) break;
 			}
-			else if (iSections[i].sh_type == SHT_STRTAB)
+			else if (iSections[i].sh_type == SHT_STRTAB && iSectionHdrStrTbl)
 			{
 				char * aSectionName = iSectionHdrStrTbl + iSections[i].sh_name;
 				if (!strcmp(aSectionName, ".strtab"))
@@ -179,6 +194,38 @@ void ElfImage::FindStaticSymbolTable()
 	}
 }
 
+/**
+Function to build the hash of the static symbols by name, once.
+Symbols are added in table order and probing finds the first added, so of several
+symbols with the same name the first in the table is found.
+@internalComponent
+@released
+*/
+void ElfImage::IndexStaticSymbols()
+{
+	if (!iStaticHash.empty())
+		return;
+	if (!iElfHeader->e_shnum)
+		throw Elf2e32Error(NOSTATICSYMBOLSERROR, iElfInput);
+	FindStaticSymbolTable();
+	if (!iSymTab || !iStrTab)
+		throw Elf2e32Error(NOSTATICSYMBOLSERROR, iElfInput);
+
+	size_t size = 2;
+	while (size < 2 * (size_t)(iLim - iSymTab))
+		size <<= 1;
+	iStaticHash.assign(size, nullptr);
+	size_t mask = size - 1;
+	for (Elf32_Sym *aSym = iSymTab; aSym < iLim; aSym++)
+	{
+		if (!aSym->st_name) continue;
+		size_t i = elf_hash((const PLUCHAR*)(iStrTab + aSym->st_name)) & mask;
+		while (iStaticHash[i])
+			i = (i + 1) & mask;
+		iStaticHash[i] = aSym;
+	}
+}
+
 /**
 Function to Find the Comment Section
 @return aComment - Pointer to Comment Section
@@ -221,61 +268,47 @@ void ElfImage::ProcessVeneers()
 	{
 		ElfRelocations::Relocations & iLocalCodeRelocs = GetCodeRelocations();
 
-		Elf32_Sym *aSymTab = iSymTab;
-		int length = strlen("$Ven$AT$L$$");
+		// The sorted addresses of the code relocations, and those added here
+		const vector<Elf32_Addr> aRelocAddrs(iLocalCodeRelocs.iAddr);
+		std::unordered_set<Elf32_Addr> aAddedAddrs;
 
 		// Process the symbol table to find Long ARM to Thumb Veneers
 		// i.e. symbols of the form '$Ven$AT$L$$'
-		for(; aSymTab < iLim; aSymTab++)
+		for(auto aSym: LookupStaticSymbols("$Ven$AT$L$$"))
 		{
-			if (!aSymTab->st_name) continue;
-			char * aSymName = iStrTab + aSymTab->st_name;
-			Elf32_Sym	*aSym;
-
-			if (!strncmp(aSymName, "$Ven$AT$L$$", length))
+			Elf32_Addr r_offset = aSym->st_value;
+			Elf32_Addr aOffset = r_offset + 4;
+			Elf32_Word	aInstruction = FindValueAtLoc(r_offset);
+
+			// Check if there is a relocation entry for the veneer symbol
+			auto aAddr = std::lower_bound(aRelocAddrs.begin(), aRelocAddrs.end(), aOffset);
+			bool aRelocEntryFound = (aAddr != aRelocAddrs.end() && *aAddr == aOffset) ||
+				aAddedAddrs.count(aOffset);
+
+			Elf32_Word aPointer = FindValueAtLoc(aOffset);
+
+			/* If the symbol addresses a Thumb instruction, its value is the
+			 * address of the instruction with bit zero set (in a
+			 * relocatable object, the section offset with bit zero set).
+			 * This allows a linker to distinguish ARM and Thumb code symbols
+			 * without having to refer to the map. An ARM symbol will always have
+			 * an even value, while a Thumb symbol will always have an odd value.
+			 * Reference: Section 4.5.3 in Elf for the ARM Architecture Doc
+			 * aIsThumbSymbol will be 1 for a thumb symbol and 0 for ARM symbol
+			 */
+			int aIsThumbSymbol = aPointer & 0x1;
+
+			/* The relocation entry should be generated for the veneer only if
+			 * the following three conditions are satisfied:
+			 * 1) Check if the instruction at the symbol is as expected
+			 *    i.e. has the bit pattern 0xe51ff004 == 'LDR pc,[pc,#-4]'
+			 * 2) There is no relocation entry generated for the veneer symbol
+			 * 3) The instruction in the location provided by the pointer is a thumb symbol
+			 */
+			if (aInstruction == 0xE51FF004 && !aRelocEntryFound && aIsThumbSymbol)
 			{
-				aSym = aSymTab;
-				Elf32_Addr r_offset = aSym->st_value;
-				Elf32_Addr aOffset = r_offset + 4;
-				Elf32_Word	aInstruction = FindValueAtLoc(r_offset);
-				bool aRelocEntryFound = false;
-
-				for(auto x: iLocalCodeRelocs)
-				{
-					// Check if there is a relocation entry for the veneer symbol
-					if (x->iAddr == aOffset)
-					{
-						aRelocEntryFound = true;
-						break;
-					}
-				}
-
-				Elf32_Word aPointer = FindValueAtLoc(aOffset);
-
-				/* If the symbol addresses a Thumb instruction, its value is the
-				 * address of the instruction with bit zero set (in a
-				 * relocatable object, the section offset with bit zero set).
-				 * This allows a linker to distinguish ARM and Thumb code symbols
-				 * without having to refer to the map. An ARM symbol will always have
-				 * an even value, while a Thumb symbol will always have an odd value.
-				 * Reference: Section 4.5.3 in Elf for the ARM Architecture Doc
-				 * aIsThumbSymbol will be 1 for a thumb symbol and 0 for ARM symbol
-				 */
-				int aIsThumbSymbol = aPointer & 0x1;
-
-				/* The relocation entry should be generated for the veneer only if
-				 * the following three conditions are satisfied:
-				 * 1) Check if the instruction at the symbol is as expected
-				 *    i.e. has the bit pattern 0xe51ff004 == 'LDR pc,[pc,#-4]'
-				 * 2) There is no relocation entry generated for the veneer symbol
-				 * 3) The instruction in the location provided by the pointer is a thumb symbol
-				 */
-				if (aInstruction == 0xE51FF004 && !aRelocEntryFound && aIsThumbSymbol)
-				{
-					ElfLocalRelocation *aRel = new ElfLocalRelocation(this, aOffset, 0, 0, R_ARM_NONE, nullptr,
-                                    ESegmentRO, aSym, false, true);
-                    AddToLocalRelocations(aRel);
-				}
+				AddToLocalRelocations(aOffset, R_ARM_NONE, aSym, ESegmentRO);
+				aAddedAddrs.insert(aOffset);
 			}
 		}
 	}
@@ -386,13 +419,19 @@ void ElfImage::AddToImports(ElfRelocation* aReloc){
 }
 
 /**
-This function adds local relocation into a list
-@param aReloc - Instance of class ElfLocalRelocation
+This function adds a local relocation
+@param aAddr - location where the relocation refers to
+@param aType - relocation type
+@param aSym - symbol of the relocation
+@param aSegmentType - segment of the location
+@param aFixup - true if the location is adjusted by the symbol value
+@param aDelSym - true if the symbol is to be deleted with the relocations
 @internalComponent
 @released
 */
-void ElfImage::AddToLocalRelocations(ElfLocalRelocation* aReloc) {
-	iElfRelocations.Add(aReloc);
+void ElfImage::AddToLocalRelocations(PLMemAddr32 aAddr, PLUCHAR aType, Elf32_Sym* aSym,
+		ESegmentType aSegmentType, bool aFixup, bool aDelSym) {
+	iElfRelocations.Add(aAddr, aType, aSym, aSegmentType, aFixup, aDelSym);
 }
 
 /**
@@ -706,9 +745,8 @@ void ElfImage::ProcessRelocations(T *aElfRel, size_t aSize){
 			}
 			else
             {
-                aRel = new ElfLocalRelocation(this, aElfRel->r_offset, aAddend,
-						aSymIdx, aType, &tmp);
-                AddToLocalRelocations((ElfLocalRelocation*)aRel);
+                AddToLocalRelocations(aElfRel->r_offset, aType, &iElfDynSym[aSymIdx],
+						SegmentType(aElfRel->r_offset), true);
 			}
 		}
 		aElfRel++;
@@ -790,18 +828,8 @@ This function returns the segment type
 
 ESegmentType ElfImage::SegmentType(Elf32_Addr aAddr) {
 
-	Elf32_Phdr *aHdr = GetSegmentAtAddr(aAddr);
-	if( !aHdr )
-		return ESegmentUndefined;
-
-	if( aHdr == iCodeSegmentHdr)
-		return ESegmentRO;
-	else if(aHdr == iDataSegmentHdr)
-		return ESegmentRW;
-	else
-		return ESegmentUndefined;
-
-	return ESegmentUndefined;
+	const TSegmentRange *aRange = SegmentRangeAtAddr(aAddr);
+	return aRange ? aRange->iType : ESegmentUndefined;
 }
 
 /**
@@ -832,28 +860,24 @@ Thsi function returns the segment header to which the address refers.
 @released
 */
 Elf32_Phdr* ElfImage::GetSegmentAtAddr(Elf32_Addr aAddr) {
-//    globalcntr++;
-  //  std::cout << globalcntr << "\n";
-	if(iCodeSegmentHdr) {
-		PLUINT32 aBase = iCodeSegmentHdr->p_vaddr;
-		if( aBase <= aAddr && aAddr < (aBase + iCodeSegmentHdr->p_memsz) ) {
-			return iCodeSegmentHdr;
-		}
-	}
-	if(iDataSegmentHdr) {
-		PLUINT32 aBase = iDataSegmentHdr->p_vaddr;
-		if( aBase <= aAddr && aAddr < (aBase + iDataSegmentHdr->p_memsz) ) {
-			return iDataSegmentHdr;
-		}
-	}
+	const TSegmentRange *aRange = SegmentRangeAtAddr(aAddr);
+	return aRange ? aRange->iHdr : nullptr;
+}
 
-	// When called from ESegmentType ElfImage::SegmentType(Elf32_Addr aAddr)
-	// for libcrypto.dll test we have have unintialized iCodeSegmentHdr and
-	// iDataSegmentHdr in some cases.
-	// This occurs if aAddr==0 and globalcntr have values 829, 1218 or
-	// aAddr==4220920 globalcntr have values 2033, 2062, 2587 and 2994
-
-    return nullptr;
+/**
+This function returns the range of the segment to which the address refers.
+The ranges are set up in ProcessElfFile(), a missing segment has the empty range.
+@param aAddr - location
+@return Segment range, or nullptr for addresses outside the code and data segments
+@internalComponent
+@released
+*/
+const ElfImage::TSegmentRange* ElfImage::SegmentRangeAtAddr(Elf32_Addr aAddr) {
+	if( aAddr - iSegmentRanges[0].iBase < iSegmentRanges[0].iSize )
+		return &iSegmentRanges[0];
+	if( aAddr - iSegmentRanges[1].iBase < iSegmentRanges[1].iSize )
+		return &iSegmentRanges[1];
+	return nullptr;
 }
 
 /**
@@ -1225,69 +1249,43 @@ This function looks up for a symbol in the static symbol table.
 @released
 */
 Elf32_Sym * ElfImage::LookupStaticSymbol(const char * aName) {
-	size_t nShdrs = iElfHeader->e_shnum;
-	if (!nShdrs)
-        throw Elf2e32Error(NOSTATICSYMBOLSERROR, iElfInput);
-
-	// find the static symbol table and string table
-	Elf32_Shdr * aShdr = ELF_ENTRY_PTR(Elf32_Shdr, iElfHeader, iElfHeader->e_shoff);
-	char * aShStrTab = ELF_ENTRY_PTR(char, iElfHeader, aShdr[iElfHeader->e_shstrndx].sh_offset);
-	Elf32_Sym * aSymTab = nullptr;
-	Elf32_Sym * aLim = nullptr;
-	char * aStrTab = nullptr;
-	for (PLUINT32 i = 0; i < nShdrs; i++)
+	IndexStaticSymbols();
+	size_t mask = iStaticHash.size() - 1;
+	for (size_t i = elf_hash((const PLUCHAR*)aName) & mask; iStaticHash[i]; i = (i + 1) & mask)
 	{
-		if (aShdr[i].sh_type == SHT_SYMTAB)
-		{
-			aSymTab = ELF_ENTRY_PTR(Elf32_Sym, iElfHeader, aShdr[i].sh_offset);
-			aLim = ELF_ENTRY_PTR(Elf32_Sym, aSymTab, aShdr[i].sh_size);
-			if (aStrTab) break;
-		}
-		else if (aShdr[i].sh_type == SHT_STRTAB)
-		{
-			char * aSectionName = aShStrTab + aShdr[i].sh_name;
-			if (!strcmp(aSectionName, ".strtab"))
-			{
-				aStrTab = ELF_ENTRY_PTR(char, iElfHeader, aShdr[i].sh_offset);
-				if (aSymTab) break;
-			}
-		}
+		if (!strcmp(iStrTab + iStaticHash[i]->st_name, aName))
+			return iStaticHash[i];
 	}
+	return nullptr;
+}
 
-	/*if(aHashTbl && aSymTab && aStrTab)
+/**
+This function looks up the symbols starting with a prefix in the static symbol table.
+The symbols sorted by name are kept for the next lookup.
+@param aPrefix - the start of the symbol names
+@return Elf symbols in table order.
+@internalComponent
+@released
+*/
+vector<Elf32_Sym*> ElfImage::LookupStaticSymbols(const char * aPrefix) {
+	IndexStaticSymbols();
+	if (iStaticByName.empty())
 	{
-		PLULONG aHashVal = Util::elf_hash((const PLUCHAR*)aName);
-		Elf32_Sword* aBuckets = ELF_ENTRY_PTR(Elf32_Sword, aHashTbl, sizeof(Elf32_HashTable) );
-		Elf32_Sword* aChains = ELF_ENTRY_PTR(Elf32_Sword, aBuckets, sizeof(Elf32_Sword)*(aHashTbl->nBuckets) );
-
-		PLUINT32 aIdx = aHashVal % aHashTbl->nBuckets;
-		aIdx = aBuckets[aIdx];
-
-		char	*aSymName;
-		do {
-			aSymName = ELF_ENTRY_PTR(char, aStrTab, aSymTab[aIdx].st_name);
-			if( !strcmp(aSymName, aName) ) {
-				return &aSymTab[aIdx];
-			}
-			aIdx = aChains[aIdx];
-		}while( aIdx > 0 );
-
-		return NULL;
+		for (auto aSym: iStaticHash)
+			if (aSym)
+				iStaticByName.push_back(aSym);
+		std::sort(iStaticByName.begin(), iStaticByName.end(), [this](Elf32_Sym *a, Elf32_Sym *b)
+			{ return strcmp(iStrTab + a->st_name, iStrTab + b->st_name) < 0; });
 	}
-	else */
 
-	if (aSymTab && aStrTab)
-	{
-		for(; aSymTab < aLim; aSymTab++)
-		{
-			if (!aSymTab->st_name) continue;
-			char * aSymName = aStrTab + aSymTab->st_name;
-			if (!strcmp(aSymName, aName))
-				return aSymTab;
-		}
-		return nullptr;
-	}else
-		throw Elf2e32Error(NOSTATICSYMBOLSERROR, iElfInput);
+	size_t length = strlen(aPrefix);
+	auto aFirst = std::lower_bound(iStaticByName.begin(), iStaticByName.end(), aPrefix,
+		[this](Elf32_Sym *a, const char *aName) { return strcmp(iStrTab + a->st_name, aName) < 0; });
+	vector<Elf32_Sym*> aSymbols;
+	for (; aFirst != iStaticByName.end() && !strncmp(iStrTab + (*aFirst)->st_name, aPrefix, length); ++aFirst)
+		aSymbols.push_back(*aFirst);
+	std::sort(aSymbols.begin(), aSymbols.end());
+	return aSymbols;
 }
 
 /**
@@ -1312,16 +1310,14 @@ ElfExports* ElfImage::GetExports() {
 
 /**
 Function to get fixup location
-@param aReloc - Instance of class ElfLocalRelocation
-@param aPlace -
+@param aPlace - location where a relocation from the Elf file refers to
 @return addres of position for relocation
 @internalComponent
 @released
 */
-Elf32_Word* ElfImage::GetFixupLocation(ElfLocalRelocation* aReloc, Elf32_Addr aPlace)
+Elf32_Word* ElfImage::GetFixupLocation(Elf32_Addr aPlace)
 {
-	Elf32_Phdr * aPhdr = aReloc->ExportTableReloc() ?
-		iCodeSegmentHdr : GetSegmentAtAddr(aPlace);
+	Elf32_Phdr * aPhdr = GetSegmentAtAddr(aPlace);
 
 	Elf32_Word offset = aPhdr->p_offset + aPlace - aPhdr->p_vaddr;
 	return ELF_ENTRY_PTR(Elf32_Word, iElfHeader, offset);
@@ -1336,15 +1332,9 @@ Function to get the segment type
 */
 ESegmentType ElfImage::Segment(Elf32_Sym *aSym)
 {
-    ESegmentType type = ESegmentUndefined;
-    if(!aSym) return type;
-
-	Elf32_Phdr * aHdr = GetSegmentAtAddr(aSym->st_value);
-
-    if (aHdr == iCodeSegmentHdr) type = ESegmentRO;
-    else if (aHdr == iDataSegmentHdr) type = ESegmentRW;
+    if(!aSym) return ESegmentUndefined;
 
-	return type;
+	return SegmentType(aSym->st_value);
 }
 
 void ElfImage::ElfInfo()
@@ -1357,22 +1347,20 @@ void ElfImage::ElfInfo()
 
     cout << "\ntext relocs count: " << iElfRelocations.GetRelocations(ESegmentRO).size() << "\n";
     cout << "text relocs begin at addr:";
-    printf("%08x\n", iElfRelocations.GetRelocations(ESegmentRO).front()->iAddr);
-    auto RelTmp  = iElfRelocations.GetRelocations(ESegmentRO);
-    for(auto x: RelTmp)
+    printf("%08x\n", iElfRelocations.GetRelocations(ESegmentRO).iAddr.front());
+    for(auto x: iElfRelocations.GetRelocations(ESegmentRO).iAddr)
     {
-    	printf("%08x .text\n", x->iAddr);
+    	printf("%08x .text\n", x);
     //	cout << x->iAddr << "\n";
     }
 
     cout << "\ndata relocs count: " << iElfRelocations.GetRelocations(ESegmentRW).size() << "\n";
     cout << "data relocs begin at addr:";
-    printf("%08x\n", iElfRelocations.GetRelocations(ESegmentRW).front()->iAddr);
+    printf("%08x\n", iElfRelocations.GetRelocations(ESegmentRW).iAddr.front());
 
-    RelTmp  = iElfRelocations.GetRelocations(ESegmentRW);
-    for(auto x: RelTmp)
+    for(auto x: iElfRelocations.GetRelocations(ESegmentRW).iAddr)
     {
-    	printf("%08x .data\n", x->iAddr);
+    	printf("%08x .data\n", x);
     //	cout << x->iAddr << "\n";
     }
 
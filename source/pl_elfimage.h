@@ -22,8 +22,10 @@
 #define _PL_ELFEXECUTABLE_H_
 
 #include <list>
+#include <vector>
 
 #include "elfdefs.h"
+#include "mappedfile.h"
 #include "pl_common.h"
 #include "pl_elfimports.h"
 #include "pl_elfexports.h"
@@ -33,7 +35,6 @@
 class Symbol;
 class ElfExports;
 class ElfRelocations;
-class ElfLocalRelocation;
 
 typedef std::list <Symbol*>	Symbols;
 
@@ -56,7 +57,8 @@ public:
 	ElfExports* GetExports();
 	bool AddToExports(char* dll, Symbol* sym);
 	void AddToImports(ElfRelocation* aReloc);
-	void AddToLocalRelocations(ElfLocalRelocation* aReloc);
+	void AddToLocalRelocations(PLMemAddr32 aAddr, PLUCHAR aType, Elf32_Sym* aSym,
+			ESegmentType aSegmentType, bool aFixup = false, bool aDelSym = false);
 	void ProcessVerInfo();
 
 	Elf32_Sym* FindSymbol(char* aSymName);
@@ -82,9 +84,15 @@ public:
 	bool ExeceptionsPresentP();
 	ElfExports::Exports& GetExportsInOrdinalOrder();
 	Elf32_Sym* LookupStaticSymbol(const char * name);
+	std::vector<Elf32_Sym*> LookupStaticSymbols(const char * aPrefix);
 private:
     void Read();
     char*  iMemBlock = nullptr;
+    MappedFile iMapping;
+    void IndexStaticSymbols();
+    bool iStaticSymbolsFound = false;
+    std::vector<Elf32_Sym*> iStaticHash;    // open addressing hash of name to symbol
+    std::vector<Elf32_Sym*> iStaticByName;  // in name order for prefix lookups
 
 public:
 	Symbols GetElfSymbols();
@@ -146,6 +154,19 @@ public:
 	MemAddr			iCodeSegment = nullptr;
 	uint32_t		iCodeSegmentSize = 0;
 	PLUINT32		iCodeSegmentIdx = 0;
+
+	/** A segment as the range of addresses [iBase, iBase+iSize) */
+	struct TSegmentRange
+	{
+		PLUINT32		iBase;
+		PLUINT32		iSize;
+		Elf32_Phdr		*iHdr;
+		ESegmentType	iType;
+	};
+	/** The code and the data segment, in the order they are searched */
+	TSegmentRange	iSegmentRanges[2] = {};
+	const TSegmentRange* SegmentRangeAtAddr(Elf32_Addr aAddr);
+
 	ElfImports		iImports;
 	ElfExports		*iExports = nullptr;
 	ElfRelocations  iElfRelocations;
@@ -222,7 +243,7 @@ public:
 	Elf32_Word Addend(Elf32_Rela* aRel);
 
 	char* SymbolFromDSO(PLUINT32  aSymbolIndex);
-	Elf32_Word* GetFixupLocation(ElfLocalRelocation* aReloc, Elf32_Addr aPlace);
+	Elf32_Word* GetFixupLocation(Elf32_Addr aPlace);
 	ESegmentType Segment(Elf32_Sym *aSym);
 	Elf32_Phdr* Segment(ESegmentType aType);
 
@@ -230,7 +251,7 @@ public:
  *  creates a relocation entry.
  */
 	void ProcessVeneers();
-/** This function processes the ELF file to find the static symbol table.
+/** This function processes the ELF file to find the static symbol table, once.
 */
 	void FindStaticSymbolTable();
 /** This function finds the .comment section
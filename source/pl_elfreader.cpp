@@ -29,18 +29,39 @@ using std::list;
 using std::fstream;
 
 
+/**
+Function for reading the elf file into memory
+The file is mapped copy-on-write, so only the pages used are read and the in place patches
+of relocations and import ordinals stay in memory. Where it can't be mapped it is read whole.
+@internalComponent
+@released
+*/
 void ElfImage::Read(){
-
-    fstream fs(iElfInput.c_str(), fstream::binary | fstream::in);
+
+    if(iMapping.Open(iElfInput))
+    {
+        iMemBlock = iMapping.Data();
+        return;
+    }
+
+    fstream fs(iElfInput.c_str(), fstream::binary | fstream::in);
     if(!fs)
-		throw Elf2e32Error(FILEOPENERROR, iElfInput);
-
-    fs.seekg(0, fs.end);
-    size_t elfSize = fs.tellg();
-    fs.seekg(0, fs.beg);
-
-    iMemBlock = new char[elfSize]();
+		throw Elf2e32Error(FILEOPENERROR, iElfInput);
+
+    fs.seekg(0, fs.end);
+    std::streamoff end = fs.tellg();
+    if(end < 0)
+        throw Elf2e32Error(FILEREADERROR, iElfInput);
+    size_t elfSize = end;
+    fs.seekg(0, fs.beg);
+
+    iMemBlock = new char[elfSize];
     fs.read(iMemBlock, elfSize);
+    if((size_t)fs.gcount() != elfSize)
+    {
+        DELETE_PTR_ARRAY(iMemBlock);
+        throw Elf2e32Error(FILEREADERROR, iElfInput);
+    }
     fs.close();
 }
 
@@ -19,7 +19,6 @@
 //
 
 #include "pl_elfrelocation.h"
-#include "pl_elflocalrelocation.h"
 #include "pl_symbol.h"
 
 /**
@@ -19,50 +19,55 @@
 //
 
 #include "pl_elfrelocations.h"
-#include "pl_elflocalrelocation.h"
+#include "pl_elfimage.h"
+#include <portable.h>
 
 /**
-Destructor for class ElfRelocations to release allocated memory
+Destructor for class ElfRelocations to release the symbols made for relocations
 @internalComponent
 @released
 */
 ElfRelocations::~ElfRelocations()
 {
-	if(!iCodeRelocations.empty())
-	{
-		for(auto x: iCodeRelocations) delete x;
-		iCodeRelocations.clear();
-	}
-
-	if(!iDataRelocations.empty())
-	{
-		for(auto x: iDataRelocations) delete x;
-		iDataRelocations.clear();
-	}
+	for(auto x: iOwnedSymbols) delete x;
 }
 
 
 /**
 Function for adding Elf local Relocations.
+@param aAddr - location where the relocation refers to
+@param aType - relocation type
+@param aSym - symbol of the relocation
+@param aSegmentType - segment of the location
+@param aFixup - true if the location is adjusted by the symbol value
+@param aDelSym - true if the symbol is to be deleted with the relocations
 @internalComponent
 @released
 */
-void ElfRelocations::Add(ElfLocalRelocation* aReloc){
-	if(!aReloc) return;
+void ElfRelocations::Add(PLMemAddr32 aAddr, PLUCHAR aType, Elf32_Sym* aSym,
+		ESegmentType aSegmentType, bool aFixup, bool aDelSym)
+{
+	if(aDelSym)
+		iOwnedSymbols.push_back(aSym);
 
-	switch (aReloc->iSegmentType)
+	Relocations * aRelocs;
+	switch (aSegmentType)
 	{
 	case ESegmentRO:
-		iCodeSorted = false;
-		iCodeRelocations.push_back(aReloc);
+		aRelocs = &iCodeRelocations;
 		break;
 	case ESegmentRW:
-		iDataSorted = false;
-		iDataRelocations.push_back(aReloc);
+		aRelocs = &iDataRelocations;
 		break;
 	default:
-		break;
+		return;
 	}
+	if(!aRelocs->empty() && aRelocs->iAddr.back() > aAddr)
+		aRelocs->iSorted = false;
+	aRelocs->iAddr.push_back(aAddr);
+	aRelocs->iType.push_back(aType);
+	aRelocs->iSymbol.push_back(aSym);
+	aRelocs->iFixup.push_back(aFixup);
 }
 
 /**
@@ -70,40 +75,102 @@ Function for getting relocations. The reloc entries are
 sorted on the address they refer to.
 @internalComponent
 @released
-@return list of relocation
+@return relocations of the segment
 */
 ElfRelocations::Relocations & ElfRelocations::GetRelocations(ESegmentType type)
-{
-    if(type == ESegmentRO)
-    {
-        if (!iCodeSorted)
-        {
-            iCodeRelocations.sort(Cmp());
-            iCodeSorted = true;
-        }
-        return iCodeRelocations;
-    }
-    if(type == ESegmentRW)
-    {
-        if (!iDataSorted)
-        {
-            iDataRelocations.sort(Cmp());
-            iDataSorted = true;
-        }
-    return iDataRelocations;
-    }
-    throw;
+{
+	if(type != ESegmentRO && type != ESegmentRW)
+		throw;
+	Relocations & aRelocs = (type == ESegmentRO) ? iCodeRelocations : iDataRelocations;
+	if(!aRelocs.iSorted)
+	{
+		aRelocs.Sort();
+		aRelocs.iSorted = true;
+	}
+	return aRelocs;
 }
 
 /**
-Overloaded operator for comparing location the relocations refer to.
+Function to sort the relocations on their address, a byte at a time from the
+lowest. Relocations with the same address stay in the order they were added.
+The bytes that all addresses share are skipped.
 @internalComponent
 @released
-@return comparison of both relocation
 */
-bool ElfRelocations::Cmp::operator()(ElfRelocation * x, ElfRelocation * y)
+void ElfRelocations::Relocations::Sort()
 {
-	return x->iAddr < y->iAddr;
+	size_t n = size();
+	if(n < 2)
+		return;
+	std::vector<PLMemAddr32> aKeys(iAddr), aNextKeys(n);
+	std::vector<PLUINT32> aOrder(n), aNextOrder(n);
+	for(size_t i = 0; i < n; i++)
+		aOrder[i] = i;
+
+	for(int shift = 0; shift < 32; shift += 8)
+	{
+		size_t aStart[257] = {};
+		for(auto x: aKeys)
+			aStart[((x >> shift) & 0xff) + 1]++;
+		if(aStart[((aKeys[0] >> shift) & 0xff) + 1] == n)
+			continue;
+		for(int b = 1; b < 257; b++)
+			aStart[b] += aStart[b - 1];
+		for(size_t i = 0; i < n; i++)
+		{
+			size_t j = aStart[(aKeys[i] >> shift) & 0xff]++;
+			aNextKeys[j] = aKeys[i];
+			aNextOrder[j] = aOrder[i];
+		}
+		aKeys.swap(aNextKeys);
+		aOrder.swap(aNextOrder);
+	}
+
+	std::vector<PLUCHAR> aType(n), aFixup(n);
+	std::vector<Elf32_Sym*> aSymbol(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		aType[i] = iType[aOrder[i]];
+		aSymbol[i] = iSymbol[aOrder[i]];
+		aFixup[i] = iFixup[aOrder[i]];
+	}
+	iAddr.swap(aKeys);
+	iType.swap(aType);
+	iSymbol.swap(aSymbol);
+	iFixup.swap(aFixup);
 }
 
+/**
+This function adjusts the fixup for a relocation entry.
+@param aElfImage - Instance of class ElfImage the relocations belong to
+@param aIdx - index of the relocation
+@return - Relocation type
+@internalComponent
+@released
+*/
+PLUINT16 ElfRelocations::Relocations::Fixup(ElfImage *aElfImage, size_t aIdx)
+{
+	Elf32_Sym * aSym = iSymbol[aIdx];
+	if(iFixup[aIdx])
+	{
+		Elf32_Word* aLoc = aElfImage->GetFixupLocation(iAddr[aIdx]);
+		if (iType[aIdx] == R_ARM_ABS32 || iType[aIdx] == R_ARM_GLOB_DAT )
+		{
+			aLoc[0] += aSym->st_value;
+		}
+	}
+
+	ESegmentType aType;
+	if( aSym )
+		aType = aElfImage->Segment(aSym);
+	else
+		aType = iSegmentType;
+
+	if (aType == ESegmentRO)
+		return KTextRelocType;
+	else if (aType == ESegmentRW)
+		return KDataRelocType;
 
+	// maybe this should be an error
+	return KInferredRelocType;
+}
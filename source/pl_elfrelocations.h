@@ -20,12 +20,11 @@
 #if !defined(_PL_ELFRELOCATIONS_H)
 #define _PL_ELFRELOCATIONS_H
 
-#include <list>
+#include <vector>
 #include "pl_common.h"
 #include "elfdefs.h"
 
-class ElfRelocation;
-class ElfLocalRelocation;
+class ElfImage;
 
 /**
 This class is for Elf relocations.
@@ -36,21 +35,40 @@ This class is for Elf relocations.
 class ElfRelocations
 {
 public:
-	typedef std::list<ElfLocalRelocation*> Relocations;
+	/**
+	The local relocations of one segment, stored column by column.
+	Relocation i refers to iAddr[i], has type iType[i] and symbol iSymbol[i].
+	iFixup[i] is set for the relocations read from the Elf file, their place is
+	adjusted by the symbol value.
+	*/
+	class Relocations
+	{
+	public:
+		size_t size() const { return iAddr.size(); }
+		bool empty() const { return iAddr.empty(); }
+		PLUINT16 Fixup(ElfImage *aElfImage, size_t aIdx);
+
+		ESegmentType iSegmentType;
+		std::vector<PLMemAddr32> iAddr;
+		std::vector<PLUCHAR> iType;
+		std::vector<Elf32_Sym*> iSymbol;
+		std::vector<PLUCHAR> iFixup;
+	private:
+		friend class ElfRelocations;
+		explicit Relocations(ESegmentType aSegmentType): iSegmentType(aSegmentType) {}
+		void Sort();
+		bool iSorted = true;
+	};
 
 	~ElfRelocations();
-	void Add(ElfLocalRelocation* aReloc);
+	void Add(PLMemAddr32 aAddr, PLUCHAR aType, Elf32_Sym* aSym, ESegmentType aSegmentType,
+			bool aFixup, bool aDelSym);
 	Relocations & GetRelocations(ESegmentType type);
 
 private:
-	struct Cmp {
-		bool operator()(ElfRelocation * x, ElfRelocation * y);
-	};
-	bool iCodeSorted=false;
-	Relocations iCodeRelocations;
-	bool iDataSorted=false;
-	Relocations iDataRelocations;
-
+	Relocations iCodeRelocations{ESegmentRO};
+	Relocations iDataRelocations{ESegmentRW};
+	std::vector<Elf32_Sym*> iOwnedSymbols;
 };
 
 
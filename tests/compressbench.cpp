@@ -0,0 +1,683 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Timing of the compression code on real data, see README.md for build line.
+// Every benchmark checks that the compared implementations give the same result.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "byte_pair.h"
+#include "checksum.h"
+#include "cpufeatures.h"
+#include "errorhandler.h"
+#include "huffman.h"
+#include "inflate.h"
+#include "matchlength.h"
+
+using std::vector;
+
+typedef vector<TUint8> Buffer;
+
+void DeflateL(const TUint8* aBuf, TInt aLength, TBitOutput& aOutput, TInt aLevel, TInt aJobs);
+int InflateUnCompress(unsigned char* source, int sourcesize, unsigned char* dest, int destsize);
+
+static double Seconds(std::chrono::steady_clock::time_point aStart)
+{
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - aStart;
+    return d.count();
+}
+
+static bool ReadFile(const char* aName, Buffer& aData)
+{
+    std::ifstream f(aName, std::ios::binary);
+    if(!f)
+        return false;
+    aData.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+Compresses every 4K page of the file with both pair search methods and
+all pair scan kernels the CPU has.
+*/
+static bool BytePair(const Buffer& aData)
+{
+    static const struct
+    {
+        const char* iName;
+        BytePairContext::TPairSearch iSearch;
+        BytePairContext::TScanKernel iKernel;
+    } configs[] =
+    {
+        {"rescan", BytePairContext::EPairRescan, BytePairContext::EScanPortable},
+        {"rescan/sse2", BytePairContext::EPairRescan, BytePairContext::EScanSse2},
+        {"rescan/avx2", BytePairContext::EPairRescan, BytePairContext::EScanAvx2},
+        {"incremental", BytePairContext::EPairIncremental, BytePairContext::EScanPortable},
+        {"incremental/sse2", BytePairContext::EPairIncremental, BytePairContext::EScanSse2},
+        {"incremental/avx2", BytePairContext::EPairIncremental, BytePairContext::EScanAvx2},
+    };
+
+    vector<Buffer> reference;
+    for(const auto& c: configs)
+    {
+        std::unique_ptr<BytePairContext> context(new BytePairContext(c.iSearch, c.iKernel));
+        if(context->Kernel() != c.iKernel)
+            continue;
+        vector<Buffer> out;
+        double best = 1e9;
+        size_t total = 0;
+        for(int run = 0; run < 3; run++)
+        {
+            out.clear();
+            total = 0;
+            auto start = std::chrono::steady_clock::now();
+            TUint8 buf[MaxBlockSize*4];
+            for(size_t pos = 0; pos < aData.size(); pos += MaxBlockSize)
+            {
+                TInt size = (TInt)std::min<size_t>(MaxBlockSize, aData.size() - pos);
+                TInt n = context->Pak(buf, (TUint8*)&aData[pos], size);
+                out.push_back(Buffer(buf, buf + n));
+                total += n;
+            }
+            best = std::min(best, Seconds(start));
+        }
+        printf("bytepair %-17s %8.3f s, %zu -> %zu bytes\n", c.iName, best, aData.size(), total);
+        if(reference.empty())
+            reference.swap(out);
+        else if(out != reference)
+        {
+            printf("bytepair %s: results differ!\n", c.iName);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+Decompresses every byte-pair compressed 4K page of the file.
+*/
+static bool BytePairDecode(const Buffer& aData)
+{
+    vector<Buffer> pages;
+    TUint8 buf[MaxBlockSize*4];
+    for(size_t pos = 0; pos < aData.size(); pos += MaxBlockSize)
+    {
+        TInt size = (TInt)std::min<size_t>(MaxBlockSize, aData.size() - pos);
+        TInt n = Pak(buf, (TUint8*)&aData[pos], size);
+        pages.push_back(Buffer(buf, buf + n));
+    }
+    double best = 1e9;
+    for(int run = 0; run < 3; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < pages.size(); i++)
+        {
+            TUint8* next;
+            TInt size = Unpak(buf, MaxBlockSize, &pages[i][0], (TInt)pages[i].size(), next);
+            if(size != (TInt)std::min<size_t>(MaxBlockSize, aData.size() - i*MaxBlockSize) ||
+                memcmp(buf, &aData[i*MaxBlockSize], size))
+            {
+                printf("unpak: page %zu differs!\n", i);
+                return false;
+            }
+        }
+        best = std::min(best, Seconds(start));
+    }
+    printf("unpak %8.4f s, %zu pages\n", best, pages.size());
+    return true;
+}
+
+/**
+Checks the shortcuts of the page compressor against Pak(): PakRun() for a page
+of every byte value and size, StoresRaw() for every 4K page of the file and
+for random pages of few to all byte values.
+*/
+static bool BytePairShortcuts(const Buffer& aData)
+{
+    std::unique_ptr<BytePairContext> context(new BytePairContext);
+    TUint8 page[MaxBlockSize];
+    TUint8 buf[MaxBlockSize*4];
+    TUint8 run[MaxBlockSize*4];
+    auto start = std::chrono::steady_clock::now();
+    for(TInt value = 0; value < 0x100; value++)
+    {
+        memset(page, value, sizeof(page));
+        for(TInt size = 1; size <= MaxBlockSize; size++)
+        {
+            TInt n = context->Pak(buf, page, size);
+            if(context->PakRun(run, value, size) != n || memcmp(run, buf, n))
+            {
+                printf("pakrun: %d bytes of 0x%02x differ!\n", size, value);
+                return false;
+            }
+        }
+    }
+
+    vector<Buffer> pages;
+    for(size_t pos = 0; pos < aData.size(); pos += MaxBlockSize)
+        pages.push_back(Buffer(aData.begin() + pos, aData.begin() + std::min(pos + MaxBlockSize, aData.size())));
+    std::mt19937 random(1);
+    for(int i = 0; i < 20000; i++)
+    {
+        Buffer p(1 + random() % MaxBlockSize);
+        TUint values = 1 + random() % 0x100;
+        for(TUint8& b: p)
+            b = (TUint8)(random() % values);
+        // a few repeated pairs, some just below the token threshold
+        TInt pairs = random() % 8;
+        for(TInt j = 0; j < pairs && p.size() > 1; j++)
+        {
+            size_t at = random() % (p.size() - 1);
+            p[at] = 0x55;
+            p[at+1] = 0xAA;
+        }
+        pages.push_back(p);
+    }
+    size_t raw = 0;
+    for(Buffer& p: pages)
+    {
+        TInt size = (TInt)p.size();
+        context->CountBytes(&p[0], size);
+        bool storesRaw = context->StoresRaw(&p[0], size);
+        TInt n = context->Pak(buf, &p[0], size);
+        if(storesRaw != (buf[0] == 0))
+        {
+            printf("storesraw: page of %d bytes says %d, Pak() made %d tokens!\n", size, storesRaw, buf[0]);
+            return false;
+        }
+        if(storesRaw && (n != size + 1 || memcmp(buf + 1, &p[0], size)))
+        {
+            printf("storesraw: Pak() didn't store a page of %d bytes raw!\n", size);
+            return false;
+        }
+        raw += storesRaw;
+    }
+    printf("bytepair shortcuts %8.3f s, %zu of %zu pages raw\n", Seconds(start), raw, pages.size());
+    return true;
+}
+
+/**
+Deflates the whole file at every level on one thread and on all cores, checks
+that both give the same output and inflates it back. Sizes are also given
+relative to level 9.
+*/
+static bool Deflate(const Buffer& aData)
+{
+    Buffer check(aData.size());
+    static const TInt levels[] = {9, 8, 7, 6, 5, 4, 3, 2, 1, KDeflateOptimalLevel};
+    size_t reference = 0;
+    for(TInt level: levels)
+    {
+        char name[8];
+        snprintf(name, sizeof(name), (level == KDeflateOptimalLevel) ? "max" : "%d", level);
+        double best[2] = {1e9, 1e9};
+        Buffer result[2];
+        for(int jobs = 0; jobs < 2; jobs++)
+        {
+            int runs = (level == KDeflateOptimalLevel) ? 1 : 3;
+            for(int run = 0; run < runs; run++)
+            {
+                result[jobs].clear();
+                auto start = std::chrono::steady_clock::now();
+                TMemoryOutput output(result[jobs]);
+                DeflateL(&aData[0], (TInt)aData.size(), output, level, 1 - jobs);
+                output.FlushL();
+                best[jobs] = std::min(best[jobs], Seconds(start));
+            }
+        }
+        size_t size = result[0].size();
+        if(!reference)
+            reference = size;
+        printf("deflate level %-3s %8.3f s, all cores %8.3f s, %zu -> %zu bytes (%+.2f%%)\n", name,
+            best[0], best[1], aData.size(), size, 100.0*((double)size - reference)/reference);
+        if(result[0] != result[1])
+        {
+            printf("deflate level %s: results differ!\n", name);
+            return false;
+        }
+        InflateUnCompress(&result[0][0], (int)size, &check[0], (int)check.size());
+        if(check != aData)
+        {
+            printf("deflate level %s: inflated data differ!\n", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+Reads the symbols of a deflate stream with the decoding trees or the lookup
+tables, extra bits are skipped.
+*/
+static void Symbols(const Buffer& aStream, bool aTables, vector<TUint>& aSymbols)
+{
+    TBitInput input(&aStream[0], (TInt)aStream.size()*8);
+    TEncoding trees;
+    Huffman::InternalizeL(input, trees.iLitLen, KDeflationCodes);
+    THuffmanTable litLen, distance;
+    Huffman::Decoding(trees.iLitLen, TEncoding::ELitLens, litLen);
+    Huffman::Decoding(trees.iDistance, TEncoding::EDistances, distance, KDeflateDistCodeBase);
+    Huffman::Decoding(trees.iLitLen, TEncoding::ELitLens, trees.iLitLen);
+    Huffman::Decoding(trees.iDistance, TEncoding::EDistances, trees.iDistance, KDeflateDistCodeBase);
+
+    aSymbols.clear();
+    bool length = false;
+    for(;;)
+    {
+        TUint symbol;
+        if(length)
+            symbol = aTables ? input.HuffmanL(distance) : input.HuffmanL(trees.iDistance);
+        else
+            symbol = aTables ? input.HuffmanL(litLen) : input.HuffmanL(trees.iLitLen);
+        aSymbols.push_back(symbol);
+        if(symbol == TEncoding::EEos)
+            return;
+        if(symbol < TEncoding::ELiterals)
+            continue;
+        TInt code = (symbol - TEncoding::ELiterals) & 0xff;
+        if(code >= 8)
+            input.ReadL((code >> 2) - 1);
+        length = !length;
+    }
+}
+
+/**
+Decodes the symbols of the level 9 and max deflate streams with the decoding
+trees and the lookup tables, then inflates them through the history buffer
+and straight into the destination. A truncated stream has to be reported.
+*/
+static bool Inflate(const Buffer& aData)
+{
+    Buffer check(aData.size()), stream(aData.size());
+    static const TInt levels[] = {9, KDeflateOptimalLevel};
+    for(TInt level: levels)
+    {
+        char name[8];
+        snprintf(name, sizeof(name), (level == KDeflateOptimalLevel) ? "max" : "%d", level);
+        Buffer deflated;
+        TMemoryOutput output(deflated);
+        DeflateL(&aData[0], (TInt)aData.size(), output, level, 0);
+        output.FlushL();
+
+        vector<TUint> symbols[2];
+        double best[4] = {1e9, 1e9, 1e9, 1e9};
+        int size = 0;
+        for(int run = 0; run < 3; run++)
+        {
+            for(int tables = 0; tables < 2; tables++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                Symbols(deflated, tables != 0, symbols[tables]);
+                best[tables] = std::min(best[tables], Seconds(start));
+            }
+            auto start = std::chrono::steady_clock::now();
+            {
+                TFileInput input(&deflated[0], (int)deflated.size());
+                std::unique_ptr<CInflater> inflater(CInflater::NewLC(input));
+                inflater->ReadL(&stream[0], (TInt)stream.size());
+            }
+            best[2] = std::min(best[2], Seconds(start));
+            start = std::chrono::steady_clock::now();
+            size = InflateUnCompress(&deflated[0], (int)deflated.size(), &check[0], (int)check.size());
+            best[3] = std::min(best[3], Seconds(start));
+        }
+        printf("inflate level %-3s trees %8.4f s, tables %8.4f s, history %8.4f s, direct %8.4f s, %zu symbols\n",
+            name, best[0], best[1], best[2], best[3], symbols[0].size());
+        if(symbols[0] != symbols[1])
+        {
+            printf("inflate level %s: decoded symbols differ!\n", name);
+            return false;
+        }
+        if(check != aData || stream != aData || size != (int)aData.size())
+        {
+            printf("inflate level %s: inflated data differ!\n", name);
+            return false;
+        }
+        try
+        {
+            InflateUnCompress(&deflated[0], (int)deflated.size()/2, &check[0], (int)check.size());
+            printf("inflate level %s: truncated stream not reported!\n", name);
+            return false;
+        }
+        catch(const Elf2e32Error&)
+        {
+        }
+    }
+    return true;
+}
+
+/**
+Compares the match length variants on the candidates a deflate match finder
+tries: the last four positions within the window that start with the same
+three bytes.
+*/
+static bool MatchLengths(const Buffer& aData)
+{
+    static const struct
+    {
+        const char* iName;
+        int (*iFunc)(const uint8_t* aPtr, const uint8_t* aMatch, const uint8_t* aEnd);
+    } variants[] =
+    {
+        {"bytes", MatchLengthBytes},
+        {"words", MatchLengthWords},
+#ifdef MATCHLENGTH_SSE2
+        {"sse2", MatchLengthSse2},
+#endif
+    };
+
+    const int ways = 4;
+    vector<TInt> last(0x10000*ways, -KDeflateMaxDistance-1);
+    vector<std::pair<TInt, TInt> > pairs;
+    for(TInt pos = 0; pos + KDeflateMinLength <= (TInt)aData.size(); pos++)
+    {
+        TUint h = ((aData[pos] | aData[pos+1]<<8 | aData[pos+2]<<16)*KDeflateHashMultiplier)>>16;
+        TInt* way = &last[h*ways];
+        for(int i = 0; i < ways; i++)
+            if(pos - way[i] <= KDeflateMaxDistance)
+                pairs.push_back(std::make_pair(pos, way[i]));
+        memmove(way + 1, way, (ways - 1)*sizeof(TInt));
+        way[0] = pos;
+    }
+
+    vector<int> reference;
+    for(const auto& v: variants)
+    {
+        vector<int> lengths(pairs.size());
+        double best = 1e9;
+        size_t total = 0;
+        for(int run = 0; run < 3; run++)
+        {
+            total = 0;
+            auto start = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < pairs.size(); i++)
+            {
+                const TUint8* ptr = &aData[pairs[i].first];
+                const TUint8* end = &aData[0] + std::min<size_t>(pairs[i].first + KDeflateMaxLength, aData.size());
+                lengths[i] = v.iFunc(ptr, &aData[pairs[i].second], end);
+                total += lengths[i];
+            }
+            best = std::min(best, Seconds(start));
+        }
+        printf("matchlen %-5s %8.4f s, %zu candidates, %zu bytes matched\n", v.iName, best, pairs.size(), total);
+        if(reference.empty())
+            reference.swap(lengths);
+        else if(lengths != reference)
+        {
+            printf("matchlen %s: results differ!\n", v.iName);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+Checksums the file with every CRC implementation the CPU has and cross-checks
+them against the byte-at-a-time reference on all short lengths and alignments.
+*/
+static bool Crcs(const Buffer& aData)
+{
+    static const struct
+    {
+        const char* iName;
+        uint16_t (*iFunc)(const void* aPtr, uint32_t aLength);
+    } variants[] =
+    {
+        {"bytes", CrcBytes},
+        {"slicing8", CrcSlicing8},
+    };
+    static const struct
+    {
+        const char* iName;
+        uint32_t (*iFunc)(const void* aPtr, uint32_t aLength);
+        bool iAvailable;
+    } variants32[] =
+    {
+        {"bytes", Crc32Bytes, true},
+        {"slicing8", Crc32Slicing8, true},
+#ifdef CPU_X86
+        {"clmul", Crc32Clmul, CpuHasPclmul()},
+#endif
+    };
+
+    const TUint8* data = &aData[0];
+    uint32_t size = (uint32_t)aData.size();
+    for(const auto& v: variants)
+    {
+        double best = 1e9;
+        uint16_t crc = 0;
+        for(int run = 0; run < 3; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            crc = v.iFunc(data, size);
+            best = std::min(best, Seconds(start));
+        }
+        printf("crc16 %-8s %8.4f s, %04x\n", v.iName, best, crc);
+        bool same = (crc == CrcBytes(data, size));
+        for(uint32_t offset = 0; offset < 16 && same; offset++)
+            for(uint32_t length = 0; length <= 512 && offset + length <= size; length++)
+                same &= (v.iFunc(data + offset, length) == CrcBytes(data + offset, length));
+        if(!same)
+        {
+            printf("crc16 %s: results differ!\n", v.iName);
+            return false;
+        }
+    }
+    for(const auto& v: variants32)
+    {
+        if(!v.iAvailable)
+            continue;
+        double best = 1e9;
+        uint32_t crc = 0;
+        for(int run = 0; run < 3; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            crc = v.iFunc(data, size);
+            best = std::min(best, Seconds(start));
+        }
+        printf("crc32 %-8s %8.4f s, %08x\n", v.iName, best, crc);
+        bool same = (crc == Crc32Bytes(data, size));
+        for(uint32_t offset = 0; offset < 16 && same; offset++)
+            for(uint32_t length = 0; length <= 512 && offset + length <= size; length++)
+                same &= (v.iFunc(data + offset, length) == Crc32Bytes(data + offset, length));
+        if(!same)
+        {
+            printf("crc32 %s: results differ!\n", v.iName);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The original Huffman::HuffmanL() built with insertion sort, the reference for
+// the code lengths.
+struct OldNode
+{
+    TUint iCount;
+    TUint16 iLeft;
+    TUint16 iRight;
+};
+
+static const TUint16 KOldLeaf = 0x8000;
+
+static void OldLengths(TUint32* aLengths, const OldNode* aNodes, TInt aNode, TInt aLen)
+{
+    ++aLen;
+    const OldNode& node = aNodes[aNode];
+    TUint x = node.iLeft;
+    if(x & KOldLeaf)
+        aLengths[x & ~KOldLeaf] = aLen;
+    else
+        OldLengths(aLengths, aNodes, x, aLen);
+    x = node.iRight;
+    if(x & KOldLeaf)
+        aLengths[x & ~KOldLeaf] = aLen;
+    else
+        OldLengths(aLengths, aNodes, x, aLen);
+}
+
+static void OldInsertInOrder(OldNode* aNodes, TInt aSize, TUint aCount, TInt aVal)
+{
+    TInt left = 0, right = aSize;
+    while(left < right)
+    {
+        TInt m = (left + right) >> 1;
+        if(aNodes[m].iCount < aCount)
+            right = m;
+        else
+            left = m + 1;
+    }
+    memmove(aNodes + left + 1, aNodes + left, sizeof(OldNode)*(aSize - left));
+    aNodes[left].iCount = aCount;
+    aNodes[left].iRight = TUint16(aVal);
+}
+
+static void OldHuffman(const TUint32 aFrequency[], TInt aNumCodes, TUint32 aHuffman[])
+{
+    vector<OldNode> nodes(aNumCodes);
+    TInt count = 0;
+    for(TInt i = 0; i < aNumCodes; ++i)
+        if(aFrequency[i])
+            OldInsertInOrder(&nodes[0], count++, aFrequency[i], i | KOldLeaf);
+    memset(aHuffman, 0, aNumCodes*sizeof(TUint32));
+    if(count == 1)
+        aHuffman[nodes[0].iRight & ~KOldLeaf] = 1;
+    else if(count > 1)
+    {
+        do
+        {
+            --count;
+            TUint c = nodes[count].iCount + nodes[count-1].iCount;
+            nodes[count].iLeft = nodes[count-1].iRight;
+            OldInsertInOrder(&nodes[0], count - 1, c, count);
+        } while(count > 1);
+        OldLengths(aHuffman, &nodes[0], 1, 0);
+    }
+}
+
+/**
+Builds Huffman codes for the byte histogram of every 4K page of the file and
+for deflate sized alphabets with skewed random frequencies. The code lengths
+must be those of the original builder. Fibonacci frequencies, which need codes
+longer than the limit, must give a valid length limited code.
+*/
+static bool HuffmanCodes(const Buffer& aData)
+{
+    vector<vector<TUint32> > tables;
+    for(size_t page = 0; page < aData.size(); page += 0x1000)
+    {
+        vector<TUint32> histogram(256);
+        for(size_t i = page; i < std::min(page + 0x1000, aData.size()); i++)
+            histogram[aData[i]]++;
+        tables.push_back(histogram);
+    }
+    std::mt19937 random(1);
+    for(int i = 0; i < 1000; i++)
+    {
+        vector<TUint32> frequency((i & 1) ? (TInt)TEncoding::ELitLens : (TInt)TEncoding::EDistances);
+        for(TUint32& f: frequency)
+            f = (random() % 4) ? (random() >> (random() % 32)) % 100000 : 0;
+        tables.push_back(frequency);
+    }
+
+    vector<vector<TUint32> > lengths[2];
+    double best[2] = {1e9, 1e9};
+    for(int run = 0; run < 3; run++)
+    {
+        for(int builder = 0; builder < 2; builder++)
+        {
+            lengths[builder] = tables;
+            auto start = std::chrono::steady_clock::now();
+            for(vector<TUint32>& t: lengths[builder])
+            {
+                if(builder)
+                    Huffman::HuffmanL(&t[0], (TInt)t.size(), &t[0]);
+                else
+                    OldHuffman(&t[0], (TInt)t.size(), &t[0]);
+            }
+            best[builder] = std::min(best[builder], Seconds(start));
+        }
+    }
+    printf("huffman insertion %8.4f s, two queues %8.4f s, %zu tables\n", best[0], best[1], tables.size());
+    if(lengths[0] != lengths[1])
+    {
+        printf("huffman: code lengths differ!\n");
+        return false;
+    }
+
+    vector<TUint32> fibonacci(40);
+    fibonacci[0] = fibonacci[1] = 1;
+    for(size_t i = 2; i < fibonacci.size(); i++)
+        fibonacci[i] = fibonacci[i-1] + fibonacci[i-2];
+    vector<TUint32> limited(fibonacci.size());
+    Huffman::HuffmanL(&fibonacci[0], (TInt)fibonacci.size(), &limited[0]);
+    TUint32 longest = *std::max_element(limited.begin(), limited.end());
+    if(longest != Huffman::KMaxCodeLength || !Huffman::IsValid(&limited[0], (TInt)limited.size()))
+    {
+        printf("huffman: length limited code is wrong!\n");
+        return false;
+    }
+    return true;
+}
+
+struct Bench
+{
+    const char* iName;
+    bool (*iFunc)(const Buffer& aData);
+};
+
+static const Bench Benches[] =
+{
+    {"bytepair", BytePair},
+    {"shortcuts", BytePairShortcuts},
+    {"unpak", BytePairDecode},
+    {"deflate", Deflate},
+    {"inflate", Inflate},
+    {"matchlen", MatchLengths},
+    {"crc", Crcs},
+    {"huffman", HuffmanCodes},
+};
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        printf("usage: compressbench file [benchmark...]\n");
+        return 1;
+    }
+    Buffer data;
+    if(!ReadFile(argv[1], data))
+    {
+        printf("can't read %s\n", argv[1]);
+        return 1;
+    }
+    int failed = 0;
+    for(const Bench& b: Benches)
+    {
+        bool selected = (argc == 2);
+        for(int i = 2; i < argc; i++)
+            selected |= !strcmp(argv[i], b.iName);
+        if(selected && !b.iFunc(data))
+            failed++;
+    }
+    return failed;
+}
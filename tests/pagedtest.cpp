@@ -0,0 +1,393 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Test of the byte-pair compression of images page by page and of the page
+// cache, see README.md for build line.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "byte_pair.h"
+#include "pagecache.h"
+#include "pagedcompress.h"
+
+using std::string;
+using std::vector;
+
+typedef vector<uint8_t> Buffer;
+
+static const size_t KPageSize = 4096;
+static const char KCacheDir[] = "pagedtest.cache";
+
+static bool ReadFile(const char* aName, Buffer& aData)
+{
+    std::ifstream f(aName, std::ios::binary);
+    if(!f)
+        return false;
+    aData.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static void WriteFile(const string& aName, const Buffer& aData)
+{
+    std::ofstream f(aName, std::ios::binary | std::ios::trunc);
+    f.write((const char*)aData.data(), aData.size());
+}
+
+// Files of the cache, which keeps them in subdirectories
+static vector<string> CacheFiles(vector<string>* aDirs = nullptr)
+{
+    vector<string> files;
+    if(DIR* dir = opendir(KCacheDir))
+    {
+        while(dirent* d = readdir(dir))
+        {
+            if(d->d_name[0] == '.')
+                continue;
+            string sub = string(KCacheDir) + "/" + d->d_name;
+            if(aDirs)
+                aDirs->push_back(sub);
+            if(DIR* subDir = opendir(sub.c_str()))
+            {
+                while(dirent* e = readdir(subDir))
+                    if(e->d_name[0] != '.')
+                        files.push_back(sub + "/" + e->d_name);
+                closedir(subDir);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static void RemoveCache()
+{
+    vector<string> dirs;
+    for(const string& f: CacheFiles(&dirs))
+        remove(f.c_str());
+    for(const string& d: dirs)
+        rmdir(d.c_str());
+    rmdir(KCacheDir);
+}
+
+// A compressible page, different for every seed
+static Buffer MakePage(uint32_t aSeed, size_t aSize)
+{
+    std::mt19937 random(aSeed);
+    Buffer page(aSize);
+    for(uint8_t& b: page)
+        b = (uint8_t)(random() % 12);
+    return page;
+}
+
+// Compresses the page and stores it in the cache, returns the compressed page
+static Buffer StorePage(PageCache& aCache, Buffer& aPage)
+{
+    uint8_t out[KPageSize * 4];
+    TInt size = Pak(out, &aPage[0], (TInt)aPage.size());
+    aCache.Store(&aPage[0], (int32_t)aPage.size(), out, size);
+    return Buffer(out, out + size);
+}
+
+static bool Hits(PageCache& aCache, const Buffer& aPage, const Buffer& aOut)
+{
+    uint8_t out[KPageSize * 4];
+    int32_t size = -1;
+    return aCache.Lookup(&aPage[0], (int32_t)aPage.size(), out, size) &&
+        Buffer(out, out + size) == aOut;
+}
+
+/**
+Decodes every page on its own through the view, in random order, and checks
+it against the data and the result of DecompressPages(). A destination which
+ends inside a page gets only the pages before it.
+*/
+static bool View(const Buffer& aData)
+{
+    Buffer table;
+    CompressPages((uint8_t*)&aData[0], (int32_t)aData.size(), table, 0, false);
+
+    Buffer all(aData.size());
+    size_t tableSize;
+    int size = DecompressPages(&all[0], all.size(), &table[0], table.size(), tableSize, 0);
+    if(size != (int)aData.size() || tableSize != table.size() || all != aData)
+    {
+        printf("view: %zu bytes decompress to %d!\n", aData.size(), size);
+        return false;
+    }
+
+    BytePairImageView view;
+    if(view.Open(&table[0], table.size()) != 0 || view.TableSize() != table.size() ||
+        view.PageCount() != (aData.size() + KPageSize - 1) / KPageSize)
+    {
+        printf("view: index table of %zu bytes not parsed!\n", aData.size());
+        return false;
+    }
+    vector<uint32_t> order(view.PageCount());
+    for(uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(aData.size()));
+    uint8_t page[KPageSize];
+    for(uint32_t i: order)
+    {
+        size_t pageSize = std::min(KPageSize, aData.size() - i * KPageSize);
+        if(view.PageSize(i) != (int32_t)pageSize || view.DecompressPage(i, page) != (int32_t)pageSize ||
+            memcmp(page, &all[i * KPageSize], pageSize))
+        {
+            printf("view: page %u of %zu bytes differs!\n", i, aData.size());
+            return false;
+        }
+    }
+    if(view.DecompressPage(view.PageCount(), page) >= 0)
+    {
+        printf("view: page past the end decompressed!\n");
+        return false;
+    }
+
+    for(size_t dstSize: {(size_t)0, KPageSize - 1, KPageSize, KPageSize + 1, aData.size() - 1})
+    {
+        if(dstSize > aData.size())
+            continue;
+        size_t pages = dstSize / KPageSize;
+        if(dstSize == aData.size())
+            pages = view.PageCount();
+        size_t expected = std::min(pages * KPageSize, aData.size());
+        Buffer part(dstSize + 1, 0xCC);
+        size = DecompressPages(&part[0], dstSize, &table[0], table.size(), tableSize, 1);
+        if(size != (int)expected || memcmp(&part[0], &aData[0], expected) ||
+            std::count(part.begin() + expected, part.end(), 0xCC) != (long)(part.size() - expected))
+        {
+            printf("view: %zu of %zu bytes decompress to %d!\n", dstSize, aData.size(), size);
+            return false;
+        }
+    }
+
+    for(size_t cut: {(size_t)0, (size_t)9, (size_t)11, table.size() / 2, table.size() - 1})
+    {
+        if(view.Open(&table[0], cut) == 0)
+        {
+            printf("view: index table cut to %zu bytes accepted!\n", cut);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+A page misses, is stored and then hits with the same compressed form, also in
+a new cache on the same directory. Compression of the file with the cache,
+cold and warm, gives the output of the compressor alone.
+*/
+static bool CacheHits(const Buffer& aData)
+{
+    RemoveCache();
+    Buffer page = MakePage(1, KPageSize);
+    Buffer out;
+    {
+        PageCache cache(KCacheDir, 1 << 30);
+        uint8_t buf[KPageSize * 4];
+        int32_t size;
+        if(cache.Lookup(&page[0], (int32_t)page.size(), buf, size))
+        {
+            printf("cache: page found in an empty cache!\n");
+            return false;
+        }
+        out = StorePage(cache, page);
+        if(!Hits(cache, page, out))
+        {
+            printf("cache: stored page not found!\n");
+            return false;
+        }
+        cache.Close(false);
+    }
+    PageCache cache(KCacheDir, 1 << 30);
+    if(!Hits(cache, page, out))
+    {
+        printf("cache: stored page not found by a new cache!\n");
+        return false;
+    }
+    cache.Close(false);
+
+    Buffer table;
+    CompressPages((uint8_t*)&aData[0], (int32_t)aData.size(), table, 0, false);
+    for(int run = 0; run < 2; run++)
+    {
+        PageCache fileCache(KCacheDir, 1 << 30);
+        Buffer cached;
+        CompressPages((uint8_t*)&aData[0], (int32_t)aData.size(), cached, 0, false, &fileCache);
+        fileCache.Close(false);
+        if(cached != table)
+        {
+            printf("cache: output differs from the compressor, run %d!\n", run);
+            return false;
+        }
+        if(CacheFiles().size() < 2)
+        {
+            printf("cache: no pages of the file stored!\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+An entry which is cut short or has a damaged magic, version, page or
+compressed page is a miss. The intact entry hits again.
+*/
+static bool CacheDamage()
+{
+    RemoveCache();
+    PageCache cache(KCacheDir, 1 << 30);
+    Buffer page = MakePage(2, 1000);
+    Buffer out = StorePage(cache, page);
+    vector<string> files = CacheFiles();
+    Buffer entry;
+    if(files.size() != 1 || !ReadFile(files[0].c_str(), entry))
+    {
+        printf("cache: %zu entries for one page!\n", files.size());
+        return false;
+    }
+
+    // the version follows the magic, the page and the compressed page end the entry
+    size_t pageStart = entry.size() - out.size() - page.size();
+    for(size_t cut: {(size_t)0, (size_t)4, pageStart, entry.size() - out.size(), entry.size() - 1})
+    {
+        WriteFile(files[0], Buffer(entry.begin(), entry.begin() + cut));
+        if(Hits(cache, page, out))
+        {
+            printf("cache: entry cut to %zu bytes of %zu found!\n", cut, entry.size());
+            return false;
+        }
+    }
+    for(size_t at: {(size_t)0, (size_t)4, pageStart, pageStart + page.size(), entry.size() - 1})
+    {
+        Buffer damaged = entry;
+        damaged[at] ^= 0x40;
+        WriteFile(files[0], damaged);
+        uint8_t buf[KPageSize * 4];
+        int32_t size;
+        if(cache.Lookup(&page[0], (int32_t)page.size(), buf, size))
+        {
+            printf("cache: entry damaged at %zu of %zu found!\n", at, entry.size());
+            return false;
+        }
+    }
+    WriteFile(files[0], entry);
+    if(!Hits(cache, page, out))
+    {
+        printf("cache: restored entry not found!\n");
+        return false;
+    }
+    cache.Close(false);
+    return true;
+}
+
+/**
+Close() of a cache over its size limit removes the least recently used
+entries, a lookup makes an old entry recent.
+*/
+static bool CacheEviction()
+{
+    RemoveCache();
+    const int entries = 8;
+    vector<Buffer> pages;
+    vector<Buffer> outs;
+    vector<string> names;
+    vector<off_t> sizes;
+    PageCache cache(KCacheDir, 1 << 30);
+    for(int i = 0; i < entries; i++)
+    {
+        pages.push_back(MakePage(100 + i, KPageSize));
+        vector<string> before = CacheFiles();
+        outs.push_back(StorePage(cache, pages.back()));
+        vector<string> after = CacheFiles();
+        vector<string> added;
+        std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(added));
+        struct stat st;
+        if(added.size() != 1 || stat(added[0].c_str(), &st))
+        {
+            printf("cache: page %d stored as %zu entries!\n", i, added.size());
+            return false;
+        }
+        names.push_back(added[0]);
+        sizes.push_back(st.st_size);
+        // used in the order of storing, a minute apart
+        utimbuf times;
+        times.actime = times.modtime = time(nullptr) - 3600 + 60 * i;
+        utime(added[0].c_str(), &times);
+    }
+    // the oldest one becomes the most recent, the next four are evicted
+    if(!Hits(cache, pages[0], outs[0]))
+    {
+        printf("cache: oldest entry not found!\n");
+        return false;
+    }
+    // a cache trims only after storing, the newest entry is stored again
+    PageCache limited(KCacheDir, sizes[0] + sizes[5] + sizes[6] + sizes[7]);
+    limited.Store(&pages[7][0], (int32_t)pages[7].size(), &outs[7][0], (int32_t)outs[7].size());
+    limited.Close(false);
+    for(int i = 0; i < entries; i++)
+    {
+        bool kept = !access(names[i].c_str(), F_OK);
+        if(kept != (i == 0 || i > 4))
+        {
+            printf("cache: entry %d %s by the size limit!\n", i, kept ? "kept" : "evicted");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        printf("usage: pagedtest file\n");
+        return 1;
+    }
+    Buffer data;
+    if(!ReadFile(argv[1], data) || data.empty())
+    {
+        printf("can't read %s\n", argv[1]);
+        return 1;
+    }
+
+    // the whole file, and pieces ending inside a page
+    int failed = 0;
+    for(size_t size: {data.size(), KPageSize, KPageSize + 1, 3 * KPageSize - 5, (size_t)1})
+    {
+        Buffer part(data.begin(), data.begin() + std::min(size, data.size()));
+        if(!View(part))
+            failed++;
+    }
+    Buffer cached(data.begin(), data.begin() + std::min<size_t>(64 * KPageSize, data.size()));
+    failed += !CacheHits(cached) + !CacheDamage() + !CacheEviction();
+    RemoveCache();
+    if(!failed)
+        printf("pagedtest: all passed\n");
+    return failed;
+}
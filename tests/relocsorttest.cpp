@@ -0,0 +1,117 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Test of the sort of the local relocations against std::stable_sort, see
+// README.md for build line.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "pl_elfrelocations.h"
+
+using std::vector;
+
+static std::mt19937 Random(1);
+
+struct Reloc
+{
+    PLMemAddr32 iAddr;
+    PLUCHAR iType;
+    Elf32_Sym* iSymbol;
+    PLUCHAR iFixup;
+};
+
+// Kinds of addresses, the sort skips the bytes that all of them share
+enum TAddresses
+{
+    EAny,           // all bytes differ
+    ENarrow,        // within a few KB, many duplicates
+    EOuterBytes,    // only the lowest and the highest byte differ
+    EMiddleBytes,   // only the middle bytes differ
+    EOne,           // one address
+    EAddressKinds
+};
+
+static PLMemAddr32 Address(int aKind)
+{
+    switch(aKind)
+    {
+    case EAny:
+        return Random();
+    case ENarrow:
+        return 0x8000 + 4 * (Random() % 1000);
+    case EOuterBytes:
+        return 0x00345600 | (Random() & 0xff0000ff);
+    case EMiddleBytes:
+        return 0x12000078 | (Random() & 0x00ffff00);
+    default:
+        return 0x8000;
+    }
+}
+
+/**
+Adds aCount relocations to both segments, in random order, and checks that
+each segment comes out in the order of std::stable_sort on the address.
+The symbol tells the order of adding, so a swap of equal addresses shows.
+*/
+static bool Sort(int aKind, size_t aCount)
+{
+    ElfRelocations relocations;
+    vector<Reloc> expected[2];
+    for(size_t i = 0; i < aCount; i++)
+    {
+        int segment = Random() & 1;
+        Reloc r = {Address(aKind), (PLUCHAR)Random(), (Elf32_Sym*)(uintptr_t)(i + 1), (PLUCHAR)(Random() & 1)};
+        relocations.Add(r.iAddr, r.iType, r.iSymbol, segment ? ESegmentRW : ESegmentRO, r.iFixup, false);
+        expected[segment].push_back(r);
+    }
+    for(int segment = 0; segment < 2; segment++)
+    {
+        vector<Reloc>& e = expected[segment];
+        std::stable_sort(e.begin(), e.end(), [](const Reloc& a, const Reloc& b)
+            { return a.iAddr < b.iAddr; });
+        ElfRelocations::Relocations& found = relocations.GetRelocations(segment ? ESegmentRW : ESegmentRO);
+        bool same = found.size() == e.size();
+        for(size_t i = 0; same && i < e.size(); i++)
+            same = found.iAddr[i] == e[i].iAddr && found.iType[i] == e[i].iType &&
+                found.iSymbol[i] == e[i].iSymbol && found.iFixup[i] == e[i].iFixup;
+        if(!same)
+        {
+            printf("%zu relocations of kind %d: segment %d not sorted like std::stable_sort!\n",
+                aCount, aKind, segment);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 1000;
+    for(int kind = 0; kind < EAddressKinds; kind++)
+    {
+        for(size_t count: {0, 1, 2, 3, 255, 256, 257, 100000})
+            if(!Sort(kind, count))
+                return 1;
+        for(int run = 0; run < runs; run++)
+            if(!Sort(kind, Random() % 5000))
+                return 1;
+    }
+    printf("relocsorttest: all passed\n");
+    return 0;
+}
@@ -0,0 +1,297 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Fuzz test of the byte-pair page decoder against the original recursive one,
+// see README.md for build line.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "byte_pair.h"
+
+using std::vector;
+
+typedef vector<TUint8> Buffer;
+
+// The original Unpak(), the reference for accepted and refused input.
+static TInt OldUnpak(TUint8* dst, TInt dstSize, TUint8* src, TInt srcSize, TUint8*& srcNext)
+	{
+	TUint8* dstStart = dst;
+	TUint8* dstEnd = dst+dstSize;
+	TUint8* srcEnd = src+srcSize;
+
+	TUint32 LUT[0x100/2];
+	TUint8* LUT0 = (TUint8*)LUT;
+	TUint8* LUT1 = LUT0+0x100;
+
+	TUint8 stack[0x100];
+	TUint8* stackStart = stack+sizeof(stack);
+	TUint8* sp = stackStart;
+
+	TUint32 marker = ~0u;
+	TInt numTokens;
+	TUint32 p1;
+	TUint32 p2;
+
+	TUint32* lut = (TUint32*)LUT;
+	TUint32 b = 0x03020100;
+	TUint32 step = 0x04040404;
+	do
+		{
+		*lut++ = b;
+		b += step;
+		}
+	while(b>step);
+	// the original left LUT1 uninitialised, which only corrupt input reads
+	for(TInt i=0; i<0x100; i++)
+		LUT1[i] = (TUint8)i;
+
+	if(src>=srcEnd)
+		goto error;
+	numTokens = *src++;
+	if(numTokens)
+		{
+		if(src>=srcEnd)
+			goto error;
+		marker = *src++;
+		LUT0[marker] = (TUint8)~marker;
+
+		if(numTokens<32)
+			{
+			TUint8* tokenEnd = src+3*numTokens;
+			if(tokenEnd>srcEnd)
+				goto error;
+			do
+				{
+				TInt b = *src++;
+				TInt p1 = *src++;
+				TInt p2 = *src++;
+				LUT0[b] = (TUint8)p1;
+				LUT1[b] = (TUint8)p2;
+				}
+			while(src<tokenEnd);
+			}
+		else
+			{
+			TUint8* bitMask = src;
+			src += 32;
+			if(src>srcEnd)
+				goto error;
+			TInt b=0;
+			do
+				{
+				TUint8 mask = bitMask[b>>3];
+				if(mask&(1<<(b&7)))
+					{
+					if(src>srcEnd)
+						goto error;
+					TInt p1 = *src++;
+					if(src>srcEnd)
+						goto error;
+					TInt p2 = *src++;
+					LUT0[b] = (TUint8)p1;
+					LUT1[b] = (TUint8)p2;
+					--numTokens;
+					}
+				++b;
+				}
+			while(b<0x100);
+			if(numTokens)
+				goto error;
+			}
+		}
+
+	if(src>=srcEnd)
+		goto error;
+	b = *src++;
+	if(dst>=dstEnd)
+		goto error;
+	p1 = LUT0[b];
+	if(p1!=b)
+		goto not_single;
+next:
+	if(src>=srcEnd)
+		goto done_s;
+	b = *src++;
+	*dst++ = (TUint8)p1;
+	if(dst>=dstEnd)
+		goto done_d;
+	p1 = LUT0[b];
+	if(p1==b)
+		goto next;
+
+not_single:
+	if(b==marker)
+		goto do_marker;
+
+do_pair:
+	p2 = LUT1[b];
+	b = p1;
+	p1 = LUT0[b];
+	if(sp<=stack)
+		goto error;
+	*--sp = (TUint8)p2;
+
+recurse:
+	if(b!=p1)
+		goto do_pair;
+
+	if(sp==stackStart)
+		goto next;
+	b = *sp++;
+	if(dst>=dstEnd)
+		goto error;
+	*dst++ = (TUint8)p1;
+	p1 = LUT0[b];
+	goto recurse;
+
+do_marker:
+	if(src>=srcEnd)
+		goto error;
+	p1 = *src++;
+	goto next;
+
+error:
+	srcNext = nullptr;
+	return KErrCorrupt;
+
+done_s:
+	*dst++ = (TUint8)p1;
+	srcNext = src;
+	return dst-dstStart;
+
+done_d:
+	if(dst>=dstEnd)
+		--src;
+	srcNext = src;
+	return dst-dstStart;
+	}
+
+
+static std::mt19937 Random(1);
+
+static TInt Rand(TInt aLimit)
+{
+    return (TInt)(Random() % (TUint32)aLimit);
+}
+
+/**
+Fills a page with data of one of several kinds, from constant to random.
+*/
+static void MakePage(Buffer& aPage)
+{
+    aPage.resize(1 + Rand(MaxBlockSize));
+    TInt kind = Rand(5);
+    TInt values = 1 + Rand(kind == 4 ? 256 : 16);
+    TInt base = Rand(256);
+    for(size_t i = 0; i < aPage.size(); i++)
+    {
+        switch(kind)
+        {
+        case 0: aPage[i] = (TUint8)base; break;
+        case 1: aPage[i] = (TUint8)(base + Rand(values)); break;
+        case 2: aPage[i] = (TUint8)(i && Rand(4) ? aPage[i - 1] : Rand(256)); break;
+        case 3: aPage[i] = (TUint8)(i >= 16 && Rand(2) ? aPage[i - 1 - Rand(16)] : Rand(values)); break;
+        default: aPage[i] = (TUint8)Rand(values); break;
+        }
+    }
+}
+
+/**
+Damages compressed data in one of several ways, or leaves it intact.
+*/
+static void Damage(Buffer& aData)
+{
+    switch(Rand(6))
+    {
+    case 0:
+        break;
+    case 1:
+        aData.resize(Rand((TInt)aData.size() + 1));
+        break;
+    case 2:
+        for(TInt n = 1 + Rand(4); n > 0; n--)
+            aData[Rand((TInt)aData.size())] = (TUint8)Rand(256);
+        break;
+    case 3:
+        // damage the token table
+        for(TInt n = 1 + Rand(4); n > 0; n--)
+        {
+            TInt end = std::min<TInt>((TInt)aData.size(), 2 + 3*32 + 32);
+            aData[Rand(end)] = (TUint8)Rand(256);
+        }
+        break;
+    case 4:
+        for(TInt n = Rand(64); n > 0; n--)
+            aData.push_back((TUint8)Rand(256));
+        break;
+    default:
+        // random tokens, possibly nested deeply or cyclic
+        aData.resize(2 + Rand(64));
+        aData[0] = (TUint8)(aData.size() > 2 ? Rand(32) : 0);
+        for(size_t i = 1; i < aData.size(); i++)
+            aData[i] = (TUint8)Rand(i < 2 + 3*(size_t)aData[0] ? 256 : 16);
+        break;
+    }
+}
+
+/**
+Decodes the data with both decoders and compares the results.
+The original decoder wrote one byte past the destination when a token
+didn't fit, the new one reports that as corrupt.
+*/
+static bool Compare(Buffer& aData, TInt aDstSize)
+{
+    static TUint8 oldDst[MaxBlockSize*2];
+    static TUint8 newDst[MaxBlockSize*2];
+    TUint8* src = aData.empty() ? oldDst : &aData[0];
+    TUint8* oldNext;
+    TUint8* newNext;
+    TInt oldSize = OldUnpak(oldDst, aDstSize, src, (TInt)aData.size(), oldNext);
+    TInt newSize = Unpak(newDst, aDstSize, src, (TInt)aData.size(), newNext);
+    if(oldSize > aDstSize)
+        oldSize = KErrCorrupt, oldNext = nullptr;
+    if(oldSize != newSize || oldNext != newNext)
+        return false;
+    return newSize < 0 || !memcmp(oldDst, newDst, newSize);
+}
+
+int main(int argc, char** argv)
+{
+    TInt cases = argc > 1 ? atoi(argv[1]) : 100000;
+    Buffer page;
+    Buffer packed(MaxBlockSize*4);
+    TInt corrupt = 0;
+    for(TInt i = 0; i < cases; i++)
+    {
+        MakePage(page);
+        TInt size = Pak(&packed[0], &page[0], (TInt)page.size());
+        Buffer data(packed.begin(), packed.begin() + size);
+        Damage(data);
+        TInt dstSize = Rand(4) ? MaxBlockSize : Rand(MaxBlockSize + 1);
+        if(!Compare(data, dstSize))
+        {
+            printf("case %d: decoders differ\n", i);
+            return 1;
+        }
+        TUint8* next;
+        static TUint8 dst[MaxBlockSize];
+        corrupt += Unpak(dst, dstSize, data.empty() ? dst : &data[0], (TInt)data.size(), next) < 0;
+    }
+    printf("%d cases, %d corrupt, decoders agree\n", cases, corrupt);
+    return 0;
+}
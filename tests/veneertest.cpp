@@ -0,0 +1,256 @@
+// Copyright (c) 2026 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Test of the RVCT 2.2 veneer workaround on synthetic ELF files with many
+// veneers, see README.md for build line. Prints the time for doubling veneer
+// counts, which should double too.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pl_elfimage.h"
+
+using std::string;
+using std::vector;
+
+typedef vector<char> Buffer;
+
+static const Elf32_Addr KCodeBase = 0x8000;
+// A veneer of 8 bytes and a literal word
+static const Elf32_Addr KSlotSize = 12;
+
+static double Seconds(std::chrono::steady_clock::time_point aStart)
+{
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - aStart;
+    return d.count();
+}
+
+// Every 5th veneer points to ARM code and every 7th is not a 'LDR pc,[pc,#-4]',
+// these get no relocation. With the relocations of the code neither does every
+// 11th, which has one already.
+static bool NeedsReloc(int aVeneer, bool aCodeRelocs)
+{
+    return aVeneer % 5 && aVeneer % 7 && (!aCodeRelocs || aVeneer % 11);
+}
+
+// Every 13th veneer has a second symbol
+static bool HasTwoSymbols(int aVeneer)
+{
+    return aVeneer % 13 == 0;
+}
+
+/**
+Relocations of the code, added before the veneers are processed: the literal
+word after every other veneer and the pointer of every 11th veneer.
+*/
+static vector<Elf32_Addr> CodeRelocations(int aVeneers)
+{
+    vector<Elf32_Addr> relocs;
+    for(int i = 0; i < aVeneers; i++)
+    {
+        if(i % 11 == 0)
+            relocs.push_back(KCodeBase + KSlotSize * i + 4);
+        if(i % 2 == 0)
+            relocs.push_back(KCodeBase + KSlotSize * i + 8);
+    }
+    return relocs;
+}
+
+static size_t Append(Buffer& aFile, const void* aData, size_t aSize)
+{
+    size_t offset = aFile.size();
+    aFile.insert(aFile.end(), (const char*)aData, (const char*)aData + aSize);
+    return offset;
+}
+
+/**
+Makes an executable of one code segment holding aVeneers veneers of 8 bytes,
+each followed by a literal word, with a veneer symbol and a function symbol
+for each in .symtab. The veneer symbols are not in the order of their
+addresses. The .comment names a linker that needs the workaround if
+aWorkaround is set, otherwise one that doesn't.
+*/
+static void MakeElf(int aVeneers, bool aWorkaround, Buffer& aFile)
+{
+    aFile.assign(sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr), 0);
+
+    vector<Elf32_Word> code;
+    for(int i = 0; i < aVeneers; i++)
+    {
+        code.push_back(i % 7 ? 0xE51FF004 : 0xE1A00000);
+        code.push_back(0x100000 + 4 * i + (i % 5 ? 1 : 0));
+        code.push_back(0x200000 + 4 * i);
+    }
+    size_t codeOffset = Append(aFile, code.data(), code.size() * 4);
+
+    // the linker is fixed in build 616
+    string comment = aWorkaround ? "ARM Linker, RVCT2.2 [Build 593]" : "ARM Linker, RVCT2.2 [Build 616]";
+    size_t commentOffset = Append(aFile, comment.c_str(), comment.size() + 1);
+
+    vector<int> order;
+    for(int i = 0; i < aVeneers; i++)
+    {
+        order.push_back(i);
+        if(HasTwoSymbols(i))
+            order.push_back(i);
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(aVeneers));
+
+    string strtab(1, '\0');
+    vector<Elf32_Sym> symtab(1);
+    for(size_t n = 0; n < order.size(); n++)
+    {
+        int i = order[n];
+        char name[32];
+        for(int veneer = 0; veneer < 2; veneer++)
+        {
+            snprintf(name, sizeof(name), veneer ? "$Ven$AT$L$$f%d_%d" : "f%d_%d", i, (int)n);
+            Elf32_Sym sym = {};
+            sym.st_name = strtab.size();
+            sym.st_value = veneer ? KCodeBase + KSlotSize * i : 0x100000 + 4 * i + 1;
+            sym.st_shndx = 1;
+            symtab.push_back(sym);
+            strtab.append(name, strlen(name) + 1);
+        }
+    }
+    size_t symtabOffset = Append(aFile, symtab.data(), symtab.size() * sizeof(Elf32_Sym));
+    size_t strtabOffset = Append(aFile, strtab.data(), strtab.size());
+    const char shstrtab[] = "\0.comment\0.symtab\0.strtab\0.shstrtab";
+    size_t shstrtabOffset = Append(aFile, shstrtab, sizeof(shstrtab));
+
+    Elf32_Shdr shdrs[5] = {};
+    shdrs[1].sh_name = 1;
+    shdrs[1].sh_type = SHT_PROGBITS;
+    shdrs[1].sh_offset = commentOffset;
+    shdrs[1].sh_size = comment.size() + 1;
+    shdrs[2].sh_name = 10;
+    shdrs[2].sh_type = SHT_SYMTAB;
+    shdrs[2].sh_offset = symtabOffset;
+    shdrs[2].sh_size = symtab.size() * sizeof(Elf32_Sym);
+    shdrs[2].sh_entsize = sizeof(Elf32_Sym);
+    shdrs[3].sh_name = 18;
+    shdrs[3].sh_type = SHT_STRTAB;
+    shdrs[3].sh_offset = strtabOffset;
+    shdrs[3].sh_size = strtab.size();
+    shdrs[4].sh_name = 26;
+    shdrs[4].sh_type = SHT_STRTAB;
+    shdrs[4].sh_offset = shstrtabOffset;
+    shdrs[4].sh_size = sizeof(shstrtab);
+    size_t shdrOffset = Append(aFile, shdrs, sizeof(shdrs));
+
+    Elf32_Ehdr* ehdr = (Elf32_Ehdr*)&aFile[0];
+    ehdr->e_ident[EI_MAG0] = ELFMAG0;
+    ehdr->e_ident[EI_MAG1] = ELFMAG1;
+    ehdr->e_ident[EI_MAG2] = ELFMAG2;
+    ehdr->e_ident[EI_MAG3] = ELFMAG3;
+    ehdr->e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr->e_type = ET_EXEC;
+    ehdr->e_machine = EM_ARM;
+    ehdr->e_version = EV_CURRENT;
+    ehdr->e_entry = KCodeBase;
+    ehdr->e_phoff = sizeof(Elf32_Ehdr);
+    ehdr->e_shoff = shdrOffset;
+    ehdr->e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr->e_phentsize = sizeof(Elf32_Phdr);
+    ehdr->e_phnum = 1;
+    ehdr->e_shentsize = sizeof(Elf32_Shdr);
+    ehdr->e_shnum = 5;
+    ehdr->e_shstrndx = 4;
+
+    Elf32_Phdr* phdr = (Elf32_Phdr*)&aFile[sizeof(Elf32_Ehdr)];
+    phdr->p_type = PT_LOAD;
+    phdr->p_offset = codeOffset;
+    phdr->p_vaddr = KCodeBase;
+    phdr->p_paddr = KCodeBase;
+    phdr->p_filesz = code.size() * 4;
+    phdr->p_memsz = code.size() * 4;
+    phdr->p_flags = PF_X | PF_R;
+    phdr->p_align = 4;
+}
+
+/**
+Checks that the veneers got their relocations and a veneer with two symbols
+only one. Without aCodeRelocs the workaround runs from ProcessElfFile() as for
+a real input. With aCodeRelocs the code has relocations between the veneers
+first, then the veneers are processed twice, the second time adds nothing.
+*/
+static bool Veneers(const char* aName, int aVeneers, bool aCodeRelocs, double& aTime)
+{
+    Buffer file;
+    MakeElf(aVeneers, !aCodeRelocs, file);
+    {
+        std::ofstream f(aName, std::ios::binary);
+        f.write(file.data(), file.size());
+    }
+
+    ElfImage image(aName);
+    auto start = std::chrono::steady_clock::now();
+    image.ProcessElfFile();
+    vector<Elf32_Addr> expected;
+    if(aCodeRelocs)
+    {
+        image.FindStaticSymbolTable();
+        expected = CodeRelocations(aVeneers);
+        for(Elf32_Addr addr: expected)
+            image.AddToLocalRelocations(addr, R_ARM_ABS32, nullptr, ESegmentRO);
+        start = std::chrono::steady_clock::now();
+        image.ProcessVeneers();
+        image.ProcessVeneers();
+    }
+    aTime = Seconds(start);
+
+    for(int i = 0; i < aVeneers; i++)
+        if(NeedsReloc(i, aCodeRelocs))
+            expected.push_back(KCodeBase + KSlotSize * i + 4);
+    std::sort(expected.begin(), expected.end());
+    const vector<PLMemAddr32>& found = image.GetCodeRelocations().iAddr;
+    remove(aName);
+    if(found != expected)
+    {
+        printf("%d veneers: %zu relocations, %zu expected\n", aVeneers, found.size(), expected.size());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int veneers = argc > 1 ? atoi(argv[1]) : 10000;
+    const char* name = argc > 2 ? argv[2] : "veneertest.elf";
+    double previous = 0;
+    if(!Veneers(name, veneers, false, previous))
+        return 1;
+    previous = 0;
+    for(int n = veneers; n <= veneers * 8; n *= 2)
+    {
+        double time;
+        if(!Veneers(name, n, true, time))
+            return 1;
+        printf("%7d veneers %8.4fs", n, time);
+        if(previous > 0)
+            printf("  x%.1f", time / previous);
+        printf("\n");
+        previous = time;
+    }
+    return 0;
+}